@@ -0,0 +1,204 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include <string.h>
+
+#include "batch816.h"
+#include "emu816.h"
+#include "load816.h"
+#include "pool816.h"
+
+//==============================================================================
+
+// Never used.
+batch816::batch816()
+{ }
+
+// Never used.
+batch816::~batch816()
+{ }
+
+//==============================================================================
+// Manifest and Results Files
+//------------------------------------------------------------------------------
+
+// Read the job manifest. Blank lines and those starting with ';' or '#' are
+// ignored. An input of '-' means the job has no console input.
+bool batch816::readManifest(const char *filename, vector<Job> &jobs,
+	unsigned long limit)
+{
+	ifstream	file(filename);
+	string		line;
+
+	if (!file.is_open()) return (false);
+
+	while (getline(file, line)) {
+		istringstream	fields(line);
+		Job				job;
+		string			input;
+
+		if (!(fields >> job.image)) continue;
+		if ((job.image[0] == ';') || (job.image[0] == '#')) continue;
+
+		if ((fields >> input) && (input != "-"))
+			job.input = input;
+		if (!(fields >> job.limit))
+			job.limit = limit;
+
+		jobs.push_back(job);
+	}
+	return (true);
+}
+
+// Write a string as a quoted JSON value
+static void writeString(ostream &out, const string &value)
+{
+	out << '"';
+	for (size_t index = 0; index < value.size(); ++index) {
+		unsigned char ch = value[index];
+
+		switch (ch) {
+		case '"':	out << "\\\""; break;
+		case '\\':	out << "\\\\"; break;
+		case '\n':	out << "\\n"; break;
+		case '\r':	out << "\\r"; break;
+		case '\t':	out << "\\t"; break;
+		default:
+			if ((ch < 0x20) || (ch >= 0x7f))
+				out << "\\u00" << wdc816::toHex(ch, 2);
+			else
+				out << ch;
+		}
+	}
+	out << '"';
+}
+
+// Write the results file in job order
+bool batch816::writeResults(const char *filename, const vector<Job> &jobs,
+	const vector<Result> &results)
+{
+	ofstream	file(filename);
+
+	if (!file.is_open()) return (false);
+
+	for (size_t index = 0; index < jobs.size(); ++index) {
+		const Result &result = results[index];
+
+		file << "{\"job\":" << index << ",\"image\":";
+		writeString(file, jobs[index].image);
+		file << ",\"status\":\"" << result.status << '"';
+		file << ",\"cycles\":" << result.cycles;
+		file << ",\"secs\":" << result.secs;
+		file << ",\"output\":";
+		writeString(file, result.output);
+		file << '}' << endl;
+	}
+	return (true);
+}
+
+//==============================================================================
+// Job Execution
+//------------------------------------------------------------------------------
+
+// Run one job on the calling worker's emulator
+void batch816::runJob(const Job &job, Result &result, Addr memMask,
+	Addr ramSize)
+{
+	static thread_local emu816::RAM ram;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	istringstream	in;
+	ostringstream	out;
+	emu816::Space	space;
+
+	if (ramSize) {
+		ram.assign(ramSize, 0);
+		emu816::setMemory(memMask, ramSize, ram.data(), NULL);
+	}
+	else
+		emu816::setMemory(&space);
+
+	result.status = "error";
+	result.cycles = 0;
+
+	// A job whose image or input cannot be read is not run
+	bool	ready = load816::load(job.image.c_str());
+
+	if (ready && !job.input.empty()) {
+		ifstream	file(job.input.c_str(), ios::binary);
+
+		if (file.is_open()) {
+			ostringstream data;
+
+			data << file.rdbuf();
+			in.str(data.str());
+		}
+		else
+			ready = false;
+	}
+
+	if (ready) {
+		emu816::setConsole(&in, &out);
+		emu816::reset(false);
+
+		emu816::run(job.limit);
+		emu816::setConsole(&cin, &cout);
+
+		if (emu816::isStopped())
+			result.status = "stopped";
+		else
+			result.status = emu816::isWaiting() ? "parked" : "limit";
+		result.cycles = emu816::getCycles();
+	}
+
+	// The sparse space goes with this call so the worker must not keep it
+	if (!ramSize)
+		emu816::setMemory((emu816::Space *) NULL);
+
+	result.output = out.str();
+	result.secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Run all the jobs and wait for them to complete
+void batch816::run(const vector<Job> &jobs, vector<Result> &results,
+	unsigned int threads, Addr memMask, Addr ramSize)
+{
+	pool816		pool(threads);
+
+	results.resize(jobs.size());
+
+	for (size_t index = 0; index < jobs.size(); ++index) {
+		const Job  *job = &jobs[index];
+		Result	   *result = &results[index];
+
+		pool.submit([=] { runJob(*job, *result, memMask, ramSize); });
+	}
+	pool.wait();
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef BATCH816_H
+#define BATCH816_H
+
+#include <string>
+#include <vector>
+
+#include "wdc816.h"
+
+// The batch816 class runs a manifest of independent guest programs across a
+// work-stealing pool of threads, each job on a freshly reset emulator, and
+// collects the console output, exit status, cycles and wall time of each.
+
+class batch816 :
+	public wdc816
+{
+public:
+	// A guest program to be run
+	struct Job {
+		std::string		image;			// S19/28 file to load
+		std::string		input;			// File feeding WDM #$02, or empty
+		unsigned long	limit;			// Cycles before the job is abandoned
+	};
+
+	// The outcome of a job
+	struct Result {
+		const char	   *status;			// "stopped", "limit", "parked" or "error"
+		std::string		output;			// Bytes written by WDM #$01
+		unsigned long long cycles;		// Cycles executed
+		double			secs;			// Wall time taken
+	};
+
+	// Read a manifest of jobs, one per line as "image [input|-] [limit]"
+	static bool readManifest(const char *filename, std::vector<Job> &jobs,
+		unsigned long limit);
+
+	// Run all the jobs on a pool of the given size (zero for one per core). A
+	// ramSize of zero gives each job a sparse 16M address space.
+	static void run(const std::vector<Job> &jobs, std::vector<Result> &results,
+		unsigned int threads, Addr memMask, Addr ramSize);
+
+	// Write the results as one JSON object per line
+	static bool writeResults(const char *filename, const std::vector<Job> &jobs,
+		const std::vector<Result> &results);
+
+private:
+	batch816();
+	~batch816();
+
+	static void runJob(const Job &job, Result &result, Addr memMask,
+		Addr ramSize);
+};
+#endif
\ No newline at end of file
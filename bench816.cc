@@ -0,0 +1,802 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32) || defined (_WIN64)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+using namespace std;
+
+#include "bench816.h"
+#include "emu816.h"
+
+//==============================================================================
+// Workload Assembly
+//------------------------------------------------------------------------------
+
+// Appends instructions to a workload. Branches back to a noted address are
+// resolved at once and forward branches when their target is reached.
+class Code
+{
+public:
+	typedef wdc816::Byte	Byte;
+	typedef wdc816::Word	Word;
+
+	Code(bench816::Workload &workload)
+		: workload(workload)
+	{ }
+
+	// Add an opcode or operand byte
+	Code &b(Byte value)
+	{
+		workload.code.push_back(value);
+		return (*this);
+	}
+
+	// Add a word operand
+	Code &w(Word value)
+	{
+		return (b(wdc816::lo(value)).b(wdc816::hi(value)));
+	}
+
+	// Add an immediate operand sized by a register width
+	Code &v(Word value, bool wide)
+	{
+		return (wide ? w(value) : b(wdc816::lo(value)));
+	}
+
+	// The address of the next byte
+	Word here() const
+	{
+		return ((Word)(workload.origin + workload.code.size()));
+	}
+
+	// Add a branch to an earlier address
+	Code &back(Byte opcode, Word target)
+	{
+		Byte	offset = (Byte)(target - (here() + 2));
+
+		return (b(opcode).b(offset));
+	}
+
+	// Add a branch to a later address, returning where to fix it
+	size_t ahead(Byte opcode)
+	{
+		b(opcode).b(0);
+		return (workload.code.size() - 1);
+	}
+
+	// Pad with BRKs up to a later address
+	Code &to(Word address)
+	{
+		while (here() < address) b(0x00);
+		return (*this);
+	}
+
+	// Point a forward branch at the next byte
+	void land(size_t offset)
+	{
+		workload.code[offset] = (Byte)(workload.code.size() - (offset + 1));
+	}
+
+private:
+	bench816::Workload &workload;
+};
+
+//==============================================================================
+
+const double bench816::TOLERANCE = 0.10;
+
+// Never used.
+bench816::bench816()
+{ }
+
+// Never used.
+bench816::~bench816()
+{ }
+
+// Start a new workload
+static Code begin(vector<bench816::Workload> &suite, const char *name,
+	const char *description)
+{
+	suite.push_back(bench816::Workload());
+	suite.back().name = name;
+	suite.back().description = description;
+	suite.back().origin = 0x1000;
+	return (Code(suite.back()));
+}
+
+// Build the standard workloads. Each ends with WDM #$FF and runs for tens of
+// millions of cycles.
+void bench816::workloads(vector<Workload> &suite)
+{
+	Word	outer, inner, target;
+	size_t	fix;
+
+	suite.reserve(8);
+
+	// Arithmetic and logic on the 16-bit accumulator
+	{
+		Code c = begin(suite, "alu", "16-bit arithmetic, logic and shifts");
+
+		c.b(0x18).b(0xfb);					// CLC ; XCE
+		c.b(0xc2).b(0x30);					// REP #$30
+		c.b(0x64).b(0x00);					// STZ $00
+		c.b(0xa0).w(400);					// LDY #400
+		outer = c.here();
+		c.b(0xa2).w(1000);					// LDX #1000
+		inner = c.here();
+		c.b(0x8a);							// TXA
+		c.b(0x69).w(0x1234);				// ADC #$1234
+		c.b(0x49).w(0x5a5a);				// EOR #$5A5A
+		c.b(0x0a);							// ASL A
+		c.b(0x2a);							// ROL A
+		c.b(0x29).w(0x7fff);				// AND #$7FFF
+		c.b(0x09).w(0x0101);				// ORA #$0101
+		c.b(0x4a);							// LSR A
+		c.b(0x6a);							// ROR A
+		c.b(0x38);							// SEC
+		c.b(0xe9).w(0x0042);				// SBC #$0042
+		c.b(0xc9).w(0x8000);				// CMP #$8000
+		c.b(0x89).w(0x4000);				// BIT #$4000
+		c.b(0x1a);							// INC A
+		c.b(0x3a);							// DEC A
+		c.b(0x18);							// CLC
+		c.b(0x65).b(0x00);					// ADC $00
+		c.b(0x85).b(0x00);					// STA $00
+		c.b(0xca);							// DEX
+		c.back(0xd0, inner);				// BNE inner
+		c.b(0x88);							// DEY
+		c.back(0xd0, outer);				// BNE outer
+		c.b(0x42).b(0xff);					// WDM #$FF
+	}
+
+	// Byte sized loads and stores through several addressing modes
+	{
+		Code c = begin(suite, "memory8", "8-bit loads and stores, indexed and indirect");
+
+		c.b(0x18).b(0xfb);					// CLC ; XCE
+		c.b(0xc2).b(0x30);					// REP #$30
+		c.b(0xa9).w(0x4000);				// LDA #$4000
+		c.b(0x85).b(0x20);					// STA $20
+		c.b(0xe2).b(0x20);					// SEP #$20
+		c.b(0x64).b(0x10);					// STZ $10
+		c.b(0xa0).w(200);					// LDY #200
+		outer = c.here();
+		c.b(0xa2).w(0x0000);				// LDX #0
+		inner = c.here();
+		c.b(0xbd).w(0x2000);				// LDA $2000,X
+		c.b(0x9d).w(0x3000);				// STA $3000,X
+		c.b(0xa5).b(0x10);					// LDA $10
+		c.b(0x7d).w(0x3000);				// ADC $3000,X
+		c.b(0x91).b(0x20);					// STA ($20),Y
+		c.b(0xb1).b(0x20);					// LDA ($20),Y
+		c.b(0x85).b(0x10);					// STA $10
+		c.b(0xe8);							// INX
+		c.b(0xe0).w(0x0800);				// CPX #$0800
+		c.back(0xd0, inner);				// BNE inner
+		c.b(0x88);							// DEY
+		c.back(0xd0, outer);				// BNE outer
+		c.b(0x42).b(0xff);					// WDM #$FF
+	}
+
+	// Word sized loads and stores through several addressing modes
+	{
+		Code c = begin(suite, "memory16", "16-bit loads and stores, indexed and indirect");
+
+		c.b(0x18).b(0xfb);					// CLC ; XCE
+		c.b(0xc2).b(0x30);					// REP #$30
+		c.b(0xa9).w(0x4000);				// LDA #$4000
+		c.b(0x85).b(0x20);					// STA $20
+		c.b(0x64).b(0x10);					// STZ $10
+		c.b(0xa0).w(200);					// LDY #200
+		outer = c.here();
+		c.b(0xa2).w(0x0000);				// LDX #0
+		inner = c.here();
+		c.b(0xbd).w(0x2000);				// LDA $2000,X
+		c.b(0x9d).w(0x3000);				// STA $3000,X
+		c.b(0xa5).b(0x10);					// LDA $10
+		c.b(0x7d).w(0x3000);				// ADC $3000,X
+		c.b(0x91).b(0x20);					// STA ($20),Y
+		c.b(0xb1).b(0x20);					// LDA ($20),Y
+		c.b(0x85).b(0x10);					// STA $10
+		c.b(0xe8);							// INX
+		c.b(0xe8);							// INX
+		c.b(0xe0).w(0x1000);				// CPX #$1000
+		c.back(0xd0, inner);				// BNE inner
+		c.b(0x88);							// DEY
+		c.back(0xd0, outer);				// BNE outer
+		c.b(0x42).b(0xff);					// WDM #$FF
+	}
+
+	// Decimal mode addition and subtraction in both widths
+	{
+		Code c = begin(suite, "decimal", "8- and 16-bit decimal mode ADC and SBC");
+
+		c.b(0x18).b(0xfb);					// CLC ; XCE
+		c.b(0xc2).b(0x30);					// REP #$30
+		c.b(0x64).b(0x00);					// STZ $00
+		c.b(0x64).b(0x02);					// STZ $02
+		c.b(0x64).b(0x04);					// STZ $04
+		c.b(0xf8);							// SED
+		c.b(0xa0).w(300);					// LDY #300
+		outer = c.here();
+		c.b(0xa2).w(1000);					// LDX #1000
+		inner = c.here();
+		c.b(0x18);							// CLC
+		c.b(0xa5).b(0x00);					// LDA $00
+		c.b(0x69).w(0x0123);				// ADC #$0123
+		c.b(0x85).b(0x00);					// STA $00
+		c.b(0x38);							// SEC
+		c.b(0xa5).b(0x02);					// LDA $02
+		c.b(0xe9).w(0x0045);				// SBC #$0045
+		c.b(0x85).b(0x02);					// STA $02
+		c.b(0xe2).b(0x20);					// SEP #$20
+		c.b(0x18);							// CLC
+		c.b(0xa5).b(0x04);					// LDA $04
+		c.b(0x69).b(0x37);					// ADC #$37
+		c.b(0x85).b(0x04);					// STA $04
+		c.b(0x38);							// SEC
+		c.b(0xe9).b(0x19);					// SBC #$19
+		c.b(0xc2).b(0x20);					// REP #$20
+		c.b(0xca);							// DEX
+		c.back(0xd0, inner);				// BNE inner
+		c.b(0x88);							// DEY
+		c.back(0xd0, outer);				// BNE outer
+		c.b(0xd8);							// CLD
+		c.b(0x42).b(0xff);					// WDM #$FF
+	}
+
+	// Block moves up and down between banks
+	{
+		Code c = begin(suite, "block", "MVN and MVP copies of 4K between banks");
+
+		c.b(0x18).b(0xfb);					// CLC ; XCE
+		c.b(0xc2).b(0x30);					// REP #$30
+		c.b(0xa9).w(400);					// LDA #400
+		c.b(0x85).b(0x00);					// STA $00
+		outer = c.here();
+		c.b(0xa9).w(0x0fff);				// LDA #$0FFF
+		c.b(0xa2).w(0x2000);				// LDX #$2000
+		c.b(0xa0).w(0x0000);				// LDY #$0000
+		c.b(0x54).b(0x01).b(0x00);			// MVN $00,$01
+		c.b(0xa9).w(0x0fff);				// LDA #$0FFF
+		c.b(0xa2).w(0x0fff);				// LDX #$0FFF
+		c.b(0xa0).w(0x3fff);				// LDY #$3FFF
+		c.b(0x44).b(0x00).b(0x01);			// MVP $01,$00
+		c.b(0xc6).b(0x00);					// DEC $00
+		c.back(0xd0, outer);				// BNE outer
+		c.b(0x42).b(0xff);					// WDM #$FF
+	}
+
+	// Recursive Fibonacci through JSR/RTS with values kept on the stack
+	{
+		Code c = begin(suite, "recursion", "recursive subroutine calls using the stack");
+
+		c.b(0x18).b(0xfb);					// CLC ; XCE
+		c.b(0xc2).b(0x30);					// REP #$30
+		c.b(0xa9).w(0x01ff);				// LDA #$01FF
+		c.b(0x1b);							// TCS
+		c.b(0xa9).w(30);					// LDA #30
+		c.b(0x85).b(0x10);					// STA $10
+		outer = c.here();
+		c.b(0x22).w(0x1100).b(0x00);		// JSL $001100
+		c.b(0xc6).b(0x10);					// DEC $10
+		c.back(0xd0, outer);				// BNE outer
+		c.b(0x42).b(0xff);					// WDM #$FF
+
+		c.to(0x1100);
+		c.b(0xa9).w(20);					// LDA #20
+		c.b(0x20).w(0x1110);				// JSR fib
+		c.b(0x85).b(0x12);					// STA $12
+		c.b(0x6b);							// RTL
+
+		c.to(0x1110);						// fib:
+		c.b(0xc9).w(2);						// CMP #2
+		fix = c.ahead(0x30);				// BMI done
+		c.b(0x3a);							// DEC A
+		c.b(0x48);							// PHA
+		c.b(0x20).w(0x1110);				// JSR fib
+		c.b(0xaa);							// TAX
+		c.b(0x68);							// PLA
+		c.b(0xda);							// PHX
+		c.b(0x3a);							// DEC A
+		c.b(0x20).w(0x1110);				// JSR fib
+		c.b(0x18);							// CLC
+		c.b(0x63).b(0x01);					// ADC 1,S
+		c.b(0xfa);							// PLX
+		c.land(fix);						// done:
+		c.b(0x60);							// RTS
+	}
+
+	// Frequent changes of register width and processor mode
+	{
+		Code c = begin(suite, "modes", "REP/SEP and XCE mode switching");
+
+		c.b(0x18).b(0xfb);					// CLC ; XCE
+		c.b(0xc2).b(0x30);					// REP #$30
+		c.b(0xa9).w(0x01ff);				// LDA #$01FF
+		c.b(0x1b);							// TCS
+		c.b(0xa9).w(8);						// LDA #8
+		c.b(0x85).b(0x04);					// STA $04
+		outer = c.here();
+		c.b(0xa9).w(50000);					// LDA #50000
+		c.b(0x85).b(0x00);					// STA $00
+		inner = c.here();
+		c.b(0xe2).b(0x20);					// SEP #$20
+		c.b(0xa9).b(0x12);					// LDA #$12
+		c.b(0xeb);							// XBA
+		c.b(0xa9).b(0x34);					// LDA #$34
+		c.b(0xc2).b(0x20);					// REP #$20
+		c.b(0x85).b(0x02);					// STA $02
+		c.b(0xe2).b(0x30);					// SEP #$30
+		c.b(0xa2).b(0x05);					// LDX #$05
+		c.b(0xc2).b(0x10);					// REP #$10
+		c.b(0xa2).w(0x1234);				// LDX #$1234
+		c.b(0x38).b(0xfb);					// SEC ; XCE
+		c.b(0xa9).b(0x56);					// LDA #$56
+		c.b(0x18).b(0xfb);					// CLC ; XCE
+		c.b(0xc2).b(0x30);					// REP #$30
+		c.b(0xc6).b(0x00);					// DEC $00
+		c.back(0xd0, inner);				// BNE inner
+		c.b(0xc6).b(0x04);					// DEC $04
+		c.back(0xd0, outer);				// BNE outer
+		c.b(0x42).b(0xff);					// WDM #$FF
+	}
+
+	// A sieve of Eratosthenes written as 6502 code in emulation mode
+	{
+		Code c = begin(suite, "emulation", "6502-style sieve in emulation mode");
+
+		c.b(0xd8);							// CLD
+		c.b(0xa2).b(0xff);					// LDX #$FF
+		c.b(0x9a);							// TXS
+		c.b(0xa9).b(40);					// LDA #40
+		c.b(0x85).b(0xf0);					// STA $F0
+		outer = c.here();
+		c.b(0xa9).b(0x00);					// LDA #$00
+		c.b(0x85).b(0xfa);					// STA $FA
+		c.b(0xa9).b(0x20);					// LDA #$20
+		c.b(0x85).b(0xfb);					// STA $FB
+		c.b(0xa9).b(0x00);					// LDA #$00
+		c.b(0xa2).b(0x20);					// LDX #$20
+		c.b(0xa0).b(0x00);					// LDY #$00
+		inner = c.here();					// clear:
+		c.b(0x91).b(0xfa);					// STA ($FA),Y
+		c.b(0xc8);							// INY
+		c.back(0xd0, inner);				// BNE clear
+		c.b(0xe6).b(0xfb);					// INC $FB
+		c.b(0xca);							// DEX
+		c.back(0xd0, inner);				// BNE clear
+
+		c.b(0xa2).b(0x02);					// LDX #2
+		inner = c.here();					// next:
+		c.b(0xbd).w(0x2000);				// LDA $2000,X
+		fix = c.ahead(0xd0);				// BNE skip
+		c.b(0x86).b(0xf2);					// STX $F2
+		c.b(0xa9).b(0x00);					// LDA #0
+		c.b(0x85).b(0xf3);					// STA $F3
+		c.b(0x8a);							// TXA
+		c.b(0x0a);							// ASL A
+		c.b(0x85).b(0xfa);					// STA $FA
+		c.b(0xa9).b(0x00);					// LDA #0
+		c.b(0x2a);							// ROL A
+		c.b(0x18);							// CLC
+		c.b(0x69).b(0x20);					// ADC #$20
+		c.b(0x85).b(0xfb);					// STA $FB
+		target = c.here();					// mark:
+		c.b(0xa0).b(0x00);					// LDY #0
+		c.b(0xa9).b(0x01);					// LDA #1
+		c.b(0x91).b(0xfa);					// STA ($FA),Y
+		c.b(0x18);							// CLC
+		c.b(0xa5).b(0xfa);					// LDA $FA
+		c.b(0x65).b(0xf2);					// ADC $F2
+		c.b(0x85).b(0xfa);					// STA $FA
+		c.b(0xa5).b(0xfb);					// LDA $FB
+		c.b(0x65).b(0xf3);					// ADC $F3
+		c.b(0x85).b(0xfb);					// STA $FB
+		c.b(0xc9).b(0x40);					// CMP #$40
+		c.back(0xd0, target);				// BNE mark
+		c.land(fix);						// skip:
+		c.b(0xe8);							// INX
+		c.b(0xe0).b(91);					// CPX #91
+		c.back(0xd0, inner);				// BNE next
+		c.b(0xc6).b(0xf0);					// DEC $F0
+		c.b(0xf0).b(0x03);					// BEQ +3
+		c.b(0x4c).w(outer);					// JMP outer
+		c.b(0x42).b(0xff);					// WDM #$FF
+	}
+}
+
+//==============================================================================
+// Micro-benchmarks
+//------------------------------------------------------------------------------
+
+// The kinds of operand a micro-benchmark instruction can take
+enum Operand {
+	NONE, BYTE, WORD, LONG,					// Fixed size operands
+	IMM_M, IMM_X,							// Immediates sized by M or X
+	BRANCH, LONG_BRANCH,					// To the next instruction
+	VECTOR, VECTOR_LONG						// Through a table of targets
+};
+
+// An instruction to be repeated in a tight loop
+struct Micro {
+	const char	   *name;
+	const char	   *description;
+	wdc816::Byte	opcode;
+	Operand			operand;
+	wdc816::Addr	value;
+	wdc816::Byte	follow;					// An implied opcode to pair with it
+	wdc816::Byte	setup;					// An implied opcode to run first
+};
+
+// The cases are named after the addressing mode functions in emu816 followed
+// by some opcode classes. Loads are used where possible so that the loop and
+// its pointers are left alone.
+static const Micro microCases[] = {
+	{ "immm",		"LDA #imm",				0xa9, IMM_M,		0x1234,		0x00, 0x00 },
+	{ "immx",		"CPX #imm",				0xe0, IMM_X,		0x1234,		0x00, 0x00 },
+	{ "absl",		"LDA abs",				0xad, WORD,			0x2000,		0x00, 0x00 },
+	{ "absx",		"LDA abs,X",			0xbd, WORD,			0x2000,		0x00, 0x00 },
+	{ "absy",		"LDA abs,Y",			0xb9, WORD,			0x2000,		0x00, 0x00 },
+	{ "alng",		"LDA long",				0xaf, LONG,			0x012000,	0x00, 0x00 },
+	{ "alnx",		"LDA long,X",			0xbf, LONG,			0x012000,	0x00, 0x00 },
+	{ "dpag",		"LDA dp",				0xa5, BYTE,			0x10,		0x00, 0x00 },
+	{ "dpgx",		"LDA dp,X",				0xb5, BYTE,			0x10,		0x00, 0x00 },
+	{ "dpgy",		"STX dp,Y",				0x96, BYTE,			0x10,		0x00, 0x00 },
+	{ "dpgi",		"LDA (dp)",				0xb2, BYTE,			0x20,		0x00, 0x00 },
+	{ "dpix",		"LDA (dp,X)",			0xa1, BYTE,			0x20,		0x00, 0x00 },
+	{ "dpiy",		"LDA (dp),Y",			0xb1, BYTE,			0x20,		0x00, 0x00 },
+	{ "dpil",		"LDA [dp]",				0xa7, BYTE,			0x28,		0x00, 0x00 },
+	{ "dily",		"LDA [dp],Y",			0xb7, BYTE,			0x28,		0x00, 0x00 },
+	{ "srel",		"LDA sr,S",				0xa3, BYTE,			0x01,		0x00, 0x00 },
+	{ "sriy",		"LDA (sr,S),Y",			0xb3, BYTE,			0x01,		0x00, 0x00 },
+	{ "acc",		"ASL A",				0x0a, NONE,			0,			0x00, 0x00 },
+	{ "rela",		"BRA",					0x80, BRANCH,		0,			0x00, 0x00 },
+	{ "lrel",		"BRL",					0x82, LONG_BRANCH,	0,			0x00, 0x00 },
+	{ "absi",		"JMP (abs)",			0x6c, VECTOR,		0x1400,		0x00, 0x00 },
+	{ "abxi",		"JMP (abs,X)",			0x7c, VECTOR,		0x13fc,		0x00, 0x00 },
+	{ "abil",		"JML [abs]",			0xdc, VECTOR_LONG,	0x1400,		0x00, 0x00 },
+	{ "store",		"STA abs,X",			0x9d, WORD,			0x2000,		0x00, 0x00 },
+	{ "rmw",		"INC dp",				0xe6, BYTE,			0x10,		0x00, 0x00 },
+	{ "shift",		"ROL abs",				0x2e, WORD,			0x2000,		0x00, 0x00 },
+	{ "arith",		"ADC #imm",				0x69, IMM_M,		0x0101,		0x00, 0x00 },
+	{ "decimal",	"ADC #imm in decimal",	0x69, IMM_M,		0x0101,		0x00, 0xf8 },
+	{ "compare",	"CMP dp",				0xc5, BYTE,			0x10,		0x00, 0x00 },
+	{ "bits",		"TSB dp",				0x04, BYTE,			0x10,		0x00, 0x00 },
+	{ "transfer",	"TAY",					0xa8, NONE,			0,			0x00, 0x00 },
+	{ "stack",		"PHA and PLA",			0x48, NONE,			0,			0x68, 0x00 },
+	{ "call",		"JSR and RTS",			0x20, WORD,			0x1500,		0x00, 0x00 }
+};
+
+// The processor modes each case is run in
+static const struct {
+	const char	   *name;
+	bool			emulation;
+	bool			m16;
+	bool			x16;
+} microModes[] = {
+	{ "e",			true,	false,	false },
+	{ "m8x8",		false,	false,	false },
+	{ "m8x16",		false,	false,	true  },
+	{ "m16x8",		false,	true,	false },
+	{ "m16x16",		false,	true,	true  }
+};
+
+// Build a loop that repeats one instruction sixteen times per pass. X and Y
+// hold small offsets, direct page holds pointers to $2000 and $01:2000 and the
+// stack holds a pointer to $2000 for the stack relative indirect case.
+void bench816::micros(vector<Workload> &suite)
+{
+	const size_t	cases = sizeof(microCases) / sizeof(microCases[0]);
+	const size_t	modes = sizeof(microModes) / sizeof(microModes[0]);
+	const int		COPIES = 16;
+
+	suite.reserve(cases * modes);
+
+	for (size_t index = 0; index < cases; ++index) {
+		const Micro &micro = microCases[index];
+
+		for (size_t mode = 0; mode < modes; ++mode) {
+			bool	m16 = microModes[mode].m16;
+			bool	x16 = microModes[mode].x16;
+			string	name = string(micro.name) + "." + microModes[mode].name;
+			string	description = string(micro.description) + " in "
+				+ (microModes[mode].emulation ? "emulation mode" : microModes[mode].name);
+			Code	c = begin(suite, name.c_str(), description.c_str());
+			Word	outer, inner;
+			vector<Word>	targets;
+
+			c.b(0x18).b(0xfb);					// CLC ; XCE
+			c.b(0xc2).b(0x30);					// REP #$30
+			c.b(0xa9).w(0x01ff);				// LDA #$01FF
+			c.b(0x1b);							// TCS
+			c.b(0xa9).w(0x2000);				// LDA #$2000
+			c.b(0x85).b(0x20);					// STA $20
+			c.b(0x85).b(0x24);					// STA $24
+			c.b(0x85).b(0x28);					// STA $28
+			c.b(0xa9).w(0x0001);				// LDA #$0001
+			c.b(0x85).b(0x2a);					// STA $2A
+			c.b(0xf4).w(0x2000);				// PEA $2000
+			c.b(0xa2).w(4);						// LDX #4
+			c.b(0xa0).w(6);						// LDY #6
+
+			if (microModes[mode].emulation)
+				c.b(0x38).b(0xfb);				// SEC ; XCE
+			else if (!m16 || !x16)
+				c.b(0xe2).b((m16 ? 0 : 0x20) | (x16 ? 0 : 0x10));	// SEP
+
+			if (micro.setup) c.b(micro.setup);
+
+			c.b(0xa9).v(150, m16);				// LDA #150
+			c.b(0x85).b(0xf2);					// STA $F2
+			outer = c.here();
+			c.b(0xa9).v(200, m16);				// LDA #200
+			c.b(0x85).b(0xf0);					// STA $F0
+			inner = c.here();
+			for (int copy = 0; copy < COPIES; ++copy) {
+				c.b(micro.opcode);
+				switch (micro.operand) {
+				case NONE:			break;
+				case BYTE:			c.b((Byte) micro.value); break;
+				case WORD:			c.w((Word) micro.value); break;
+				case LONG:			c.w((Word) micro.value).b((Byte)(micro.value >> 16)); break;
+				case IMM_M:			c.v((Word) micro.value, m16); break;
+				case IMM_X:			c.v((Word) micro.value, x16); break;
+				case BRANCH:		c.b(0x00); break;
+				case LONG_BRANCH:	c.w(0x0000); break;
+				case VECTOR:
+					c.w((Word)(micro.value + 2 * copy));
+					targets.push_back(c.here());
+					break;
+				case VECTOR_LONG:
+					c.w((Word)(micro.value + 3 * copy));
+					targets.push_back(c.here());
+					break;
+				}
+				if (micro.follow) c.b(micro.follow);
+			}
+			c.b(0xc6).b(0xf0);					// DEC $F0
+			c.back(0xd0, inner);				// BNE inner
+			c.b(0xc6).b(0xf2);					// DEC $F2
+			c.back(0xd0, outer);				// BNE outer
+			c.b(0x42).b(0xff);					// WDM #$FF
+
+			c.to(0x1400);						// Jump vectors
+			for (size_t target = 0; target < targets.size(); ++target) {
+				c.w(targets[target]);
+				if (micro.operand == VECTOR_LONG) c.b(0x00);
+			}
+			c.to(0x1500).b(0x60);				// RTS
+		}
+	}
+}
+
+//==============================================================================
+// Measurement
+//------------------------------------------------------------------------------
+
+// Read the host's cycle counter or, where there is none, a nanosecond clock
+static unsigned long long ticks()
+{
+#if defined(_WIN32) || defined (_WIN64) || defined(__i386__) || defined(__x86_64__)
+	return (__rdtsc());
+#else
+	return (chrono::duration_cast<chrono::nanoseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Place a workload in memory and point the reset vector at it
+void bench816::load(const Workload &workload)
+{
+	for (size_t index = 0; index < workload.code.size(); ++index)
+		emu816::setByte(workload.origin + index, workload.code[index]);
+
+	emu816::setWord(0xfffc, (Word) workload.origin);
+}
+
+// Reduce a set of samples to their mean, minimum, maximum and variance
+void bench816::summarise(const vector<double> &values, double stats[4])
+{
+	double	sum = 0, sumSq = 0;
+
+	stats[1] = stats[2] = values.empty() ? 0 : values[0];
+	for (size_t index = 0; index < values.size(); ++index) {
+		sum += values[index];
+		sumSq += values[index] * values[index];
+		if (values[index] < stats[1]) stats[1] = values[index];
+		if (values[index] > stats[2]) stats[2] = values[index];
+	}
+
+	stats[0] = values.empty() ? 0 : sum / values.size();
+	stats[3] = (values.size() < 2) ? 0
+		: (sumSq - sum * stats[0]) / (values.size() - 1);
+	if (stats[3] < 0) stats[3] = 0;
+}
+
+// Time repeated runs of a workload
+void bench816::measure(const Workload &workload, unsigned int warmups,
+	unsigned int repeats, unsigned long limit, Result &result)
+{
+	vector<double>	mhz, ns, host;
+
+	result.status = "stopped";
+	result.runs = 0;
+
+	for (unsigned int run = 0; run < warmups + repeats; ++run) {
+		load(workload);
+		emu816::reset(false);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		unsigned long long first = ticks();
+		emu816::run(limit);
+		unsigned long long last = ticks();
+		chrono::steady_clock::time_point end = chrono::steady_clock::now();
+
+		double	secs = chrono::duration<double>(end - start).count();
+
+		result.instructions = emu816::getInstructions();
+		result.cycles = emu816::getCycles();
+		if (!emu816::isStopped()) {
+			result.status = "limit";
+			break;
+		}
+
+		if (run >= warmups) {
+			mhz.push_back(result.cycles / secs / 1000000.0);
+			ns.push_back(secs * 1000000000.0 / result.instructions);
+			host.push_back((double)(last - first) / result.instructions);
+			++result.runs;
+		}
+	}
+
+	summarise(mhz, result.mhz);
+	summarise(ns, result.nsPerInstruction);
+	summarise(host, result.hostCycles);
+}
+
+// Read the minimum host cycles per instruction for each workload in a file
+// of earlier results.
+bool bench816::readBaseline(const char *filename, map<string, double> &baseline,
+	int &hugePages)
+{
+	static const string	NAME = "\"workload\":\"";
+	static const string	HOST = "\"hostCycles\":{";
+	static const string	MIN = "\"min\":";
+	static const string	HUGE = "\"hugePages\":";
+
+	ifstream	file(filename);
+	string		line;
+
+	if (!file.is_open()) return (false);
+
+	while (getline(file, line)) {
+		size_t	name = line.find(NAME);
+		size_t	host = line.find(HOST);
+
+		if ((name == string::npos) || (host == string::npos)) continue;
+
+		size_t	huge = line.find(HUGE);
+
+		if (huge != string::npos)
+			hugePages = (line.compare(huge + HUGE.size(), 4, "true") == 0) ? 1 : 0;
+
+		size_t	end = line.find('"', name + NAME.size());
+		size_t	min = line.find(MIN, host);
+
+		if ((end == string::npos) || (min == string::npos)) continue;
+
+		baseline[line.substr(name + NAME.size(), end - (name + NAME.size()))] =
+			strtod(line.c_str() + min + MIN.size(), NULL);
+	}
+	return (true);
+}
+
+// Write one set of statistics as a JSON object
+static void writeStats(ostream &out, const char *name, const double stats[4])
+{
+	out << ",\"" << name << "\":{\"mean\":" << stats[0] << ",\"min\":" << stats[1]
+		<< ",\"max\":" << stats[2] << ",\"variance\":" << stats[3] << '}';
+}
+
+// Run a suite, reporting progress on the console and the results to a file.
+// The fastest run of each workload is compared with the baseline so that
+// noise from other activity on the host is not taken as a regression.
+int bench816::run(const char *filename, const char *baseline, bool micro,
+	unsigned int warmups, unsigned int repeats, unsigned long limit)
+{
+	ofstream			file(filename);
+	vector<Workload>	suite;
+	map<string, double>	before;
+	int					regressions = 0;
+	int					hugeBefore = -1;
+	bool				huge = emu816::isHugePages();
+
+	if (!file.is_open()) return (-1);
+	if (baseline && !readBaseline(baseline, before, hugeBefore)) return (-1);
+
+	// Say so when the comparison is between memory configurations
+	if ((hugeBefore >= 0) && ((hugeBefore != 0) != huge))
+		cout << "Comparing huge pages " << (huge ? "on" : "off") << " against "
+			<< (huge ? "off" : "on") << " in " << baseline << endl;
+
+	if (micro)
+		micros(suite);
+	else
+		workloads(suite);
+
+	for (size_t index = 0; index < suite.size(); ++index) {
+		const Workload &workload = suite[index];
+		Result			result;
+
+		measure(workload, warmups, repeats, limit, result);
+
+		file << "{\"workload\":\"" << workload.name << '"';
+		file << ",\"description\":\"" << workload.description << '"';
+		file << ",\"status\":\"" << result.status << '"';
+		file << ",\"instructions\":" << result.instructions;
+		file << ",\"cycles\":" << result.cycles;
+		file << ",\"runs\":" << result.runs;
+		file << ",\"hugePages\":" << (huge ? "true" : "false");
+		writeStats(file, "mhz", result.mhz);
+		writeStats(file, "nsPerInstruction", result.nsPerInstruction);
+		writeStats(file, "hostCycles", result.hostCycles);
+
+		cout << workload.name << ": " << result.status << ", "
+			<< result.instructions << " instructions, " << result.mhz[0]
+			<< " MHz, " << result.nsPerInstruction[0] << " ns/instruction, "
+			<< result.hostCycles[1] << " host cycles/instruction";
+
+		map<string, double>::const_iterator	prior = before.find(workload.name);
+
+		if ((prior != before.end()) && (prior->second > 0)) {
+			double	change = result.hostCycles[1] / prior->second - 1.0;
+			bool	regressed = change > TOLERANCE;
+
+			file << ",\"baseline\":" << prior->second;
+			file << ",\"change\":" << change;
+			file << ",\"regression\":" << (regressed ? "true" : "false");
+
+			cout << " (" << (change >= 0 ? "+" : "") << change * 100.0 << "%"
+				<< (regressed ? ", REGRESSION)" : ")");
+			if (regressed) ++regressions;
+		}
+		file << '}' << endl;
+		cout << endl;
+	}
+
+	if (baseline)
+		cout << regressions << " regression(s) against " << baseline << endl;
+	return (regressions);
+}
\ No newline at end of file
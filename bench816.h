@@ -0,0 +1,92 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef BENCH816_H
+#define BENCH816_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "wdc816.h"
+
+// The bench816 class holds a suite of guest workloads that exercise different
+// parts of the emulator and times them. The workloads are assembled in memory
+// so the suite needs no assembler and every run executes identical code.
+//
+// A second suite of micro-benchmarks repeats a single addressing mode or
+// opcode class in each processor mode so that a change to one path in the
+// emulator can be pinned down. Either suite can be compared against the
+// results of an earlier run to flag regressions.
+
+class bench816 :
+	public wdc816
+{
+public:
+	// A guest program placed in bank zero and entered through the reset vector
+	struct Workload {
+		std::string			name;
+		std::string			description;
+		Addr				origin;
+		std::vector<Byte>	code;
+	};
+
+	// The timing of a workload over its measured repetitions
+	struct Result {
+		const char	   *status;			// "stopped" or "limit"
+		unsigned long	instructions;	// Executed per run
+		unsigned long long cycles;		// ... and the cycles they took
+		unsigned int	runs;
+		double			mhz[4];			// Mean, minimum, maximum and variance
+		double			nsPerInstruction[4];
+		double			hostCycles[4];	// Host cycles per instruction
+	};
+
+	// A slowdown beyond this fraction of the baseline is a regression
+	static const double TOLERANCE;
+
+	// Build the standard workloads
+	static void workloads(std::vector<Workload> &suite);
+
+	// Build the addressing mode and opcode class micro-benchmarks
+	static void micros(std::vector<Workload> &suite);
+
+	// Run a workload the given number of times after some unmeasured warm-up
+	// runs, giving up on any run that exceeds the cycle limit.
+	static void measure(const Workload &workload, unsigned int warmups,
+		unsigned int repeats, unsigned long limit, Result &result);
+
+	// Run the whole suite, writing one JSON object per workload. If a baseline
+	// file from an earlier run is given then each workload is compared with it.
+	// Returns the number of regressions or -1 if a file could not be opened.
+	static int run(const char *filename, const char *baseline, bool micro,
+		unsigned int warmups, unsigned int repeats, unsigned long limit);
+
+private:
+	bench816();
+	~bench816();
+
+	static void load(const Workload &workload);
+	static bool readBaseline(const char *filename,
+		std::map<std::string, double> &baseline, int &hugePages);
+	static void summarise(const std::vector<double> &values, double stats[4]);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,332 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <iostream>
+
+using namespace std;
+
+#include "check816.h"
+#include "emu816.h"
+#include "op816.h"
+
+// Where the instruction under test is placed
+#define ORIGIN		0x0200
+
+// The memory cleared before, and compared after, each opcode is run
+#define MEMORY		0x0400
+
+// The number of 16-bit values sampled for each decimal instruction
+#define SAMPLES		(1 << 20)
+
+// Mismatches after this many are counted but not described
+#define REPORT		10
+
+// The status flags an addition or subtraction sets: N, V, Z and C
+#define ARITH_FLAGS	0xc3
+
+//==============================================================================
+
+// Never used.
+check816::check816()
+{ }
+
+// Never used.
+check816::~check816()
+{ }
+
+//==============================================================================
+// Execution
+//------------------------------------------------------------------------------
+
+// Execute the instruction at ORIGIN, followed by a NOP, from a known state: A,
+// X, Y and the direct page are zero, the stack is at $01FF, memory below
+// MEMORY is otherwise clear and the processor is in the given mode with the
+// given flags. Returns the state and memory afterwards.
+static void run(bool e, wdc816::Byte opcode, wdc816::Byte flags,
+	emu816::State &state, wdc816::Byte *memory)
+{
+	for (wdc816::Addr addr = 0x0000; addr < MEMORY; ++addr)
+		emu816::setByte(addr, 0x00);
+	emu816::setByte(ORIGIN, opcode);
+	emu816::setByte(ORIGIN + 4, 0xea);
+
+	emu816::save(state);
+	state.e = e ? 1 : 0;
+	state.p = flags | (e ? 0x30 : 0x00);
+	state.a = state.x = state.y = 0x0000;
+	state.dp = 0x0000;
+	state.sp = 0x01ff;
+	state.pc = ORIGIN;
+	state.pbr = state.dbr = 0x00;
+	state.stopped = false;
+	state.interrupted = false;
+	state.waiting = false;
+	state.cycles = 0;
+	emu816::restore(state);
+
+	emu816::step();
+
+	emu816::save(state);
+	for (wdc816::Addr addr = 0x0000; addr < MEMORY; ++addr)
+		memory[addr] = emu816::getByte(addr);
+}
+
+// Test if two runs left the processor and memory the same, apart from the
+// status flags in mask
+static bool same(const emu816::State &one, const wdc816::Byte *oneMemory,
+	const emu816::State &two, const wdc816::Byte *twoMemory, wdc816::Byte mask)
+{
+	for (wdc816::Addr addr = 0x0000; addr < MEMORY; ++addr)
+		if (oneMemory[addr] != twoMemory[addr]) return (false);
+
+	return ((((one.p ^ two.p) & ~mask) == 0) && (one.e == two.e)
+		&& (one.a == two.a) && (one.x == two.x) && (one.y == two.y)
+		&& (one.sp == two.sp) && (one.dp == two.dp) && (one.pc == two.pc)
+		&& (one.pbr == two.pbr) && (one.dbr == two.dbr)
+		&& (one.stopped == two.stopped) && (one.waiting == two.waiting)
+		&& (one.cycles == two.cycles));
+}
+
+// Execute one immediate instruction in native mode with decimal mode set and
+// return the accumulator and arithmetic flags it leaves. A NOP follows it so
+// that nothing can be fused. Returns false if the PC did not advance past it.
+bool check816::execute(Byte opcode, bool wide, Word a, Word data, bool carry,
+	Word &result, Byte &flags)
+{
+	emu816::State	state;
+	Word			next = ORIGIN + (wide ? 3 : 2);
+
+	emu816::setByte(ORIGIN + 0, opcode);
+	emu816::setByte(ORIGIN + 1, lo(data));
+	emu816::setByte(ORIGIN + 2, wide ? hi(data) : 0xea);
+	emu816::setByte(ORIGIN + 3, 0xea);
+
+	emu816::save(state);
+	state.e = 0;
+	state.p = 0x18 | (wide ? 0x00 : 0x20) | (carry ? 0x01 : 0x00);
+	state.a = wide ? a : lo(a);
+	state.pc = ORIGIN;
+	state.pbr = 0x00;
+	state.stopped = false;
+	state.waiting = false;
+	emu816::restore(state);
+
+	emu816::step();
+
+	emu816::save(state);
+	result = wide ? state.a : lo(state.a);
+	flags = state.p & ARITH_FLAGS;
+	return (state.pc == next);
+}
+
+//==============================================================================
+// Decimal Mode
+//------------------------------------------------------------------------------
+
+// Correct a binary sum for decimal mode one nibble at a time, lowest first,
+// as ADC and SBC did before the adjustment table was introduced
+static int adjustNibbles(int temp, bool wide)
+{
+	if ((temp & 0x000f) > 0x0009) temp += 0x0006;
+	if ((temp & 0x00f0) > 0x0090) temp += 0x0060;
+	if (wide) {
+		if ((temp & 0x0f00) > 0x0900) temp += 0x0600;
+		if ((temp & 0xf000) > 0x9000) temp += 0x6000;
+	}
+	return (temp);
+}
+
+// Work out a decimal ADC, or an SBC by adding the complement of the operand,
+// with the original nibble chain
+static wdc816::Word reference(bool subtract, bool wide, wdc816::Word a,
+	wdc816::Word data, bool carry, wdc816::Byte &flags)
+{
+	int		mask = wide ? 0xffff : 0x00ff;
+	int		sign = wide ? 0x8000 : 0x0080;
+	int		value = a & mask;
+	int		operand = (subtract ? ~data : data) & mask;
+	int		temp = adjustNibbles(value + operand + (carry ? 1 : 0), wide);
+
+	flags = 0;
+	if (temp & (mask + 1)) flags |= 0x01;
+	if (!(temp & mask)) flags |= 0x02;
+	if ((~(value ^ operand)) & (value ^ temp) & sign) flags |= 0x40;
+	if (temp & sign) flags |= 0x80;
+	return ((wdc816::Word)(temp & mask));
+}
+
+// Execute one case and compare it with the reference, describing the first
+// few mismatches. Returns true if they agree.
+bool check816::compare(Byte opcode, bool wide, Word a, Word data, bool carry,
+	ostream &out, unsigned long failures)
+{
+	Word	expected, actual;
+	Byte	expectedFlags, actualFlags;
+
+	expected = reference(opcode == 0xe9, wide, a, data, carry, expectedFlags);
+	if (execute(opcode, wide, a, data, carry, actual, actualFlags)
+			&& (actual == expected) && (actualFlags == expectedFlags))
+		return (true);
+
+	if (failures < REPORT)
+		out << (opcode == 0xe9 ? "SBC" : "ADC") << " #$"
+			<< toHex(data, wide ? 4 : 2) << " with A=" << toHex(a, wide ? 4 : 2)
+			<< " C=" << carry << ": expected " << toHex(expected, wide ? 4 : 2)
+			<< " P=" << toHex(expectedFlags, 2) << ", got " << toHex(actual, wide ? 4 : 2)
+			<< " P=" << toHex(actualFlags, 2) << endl;
+	return (false);
+}
+
+// Check every 8-bit case and a fixed pseudo-random sample of 16-bit ones for
+// both instructions
+unsigned long check816::decimal(ostream &out)
+{
+	static const Byte	opcodes[] = { 0x69, 0xe9 };
+
+	unsigned long	tests = 0;
+	unsigned long	failures = 0;
+
+	for (unsigned int index = 0; index < 2; ++index) {
+		Byte			opcode = opcodes[index];
+		unsigned long	seed = 1;
+
+		for (unsigned int a = 0; a < 0x100; ++a)
+			for (unsigned int data = 0; data < 0x100; ++data)
+				for (unsigned int carry = 0; carry < 2; ++carry, ++tests)
+					if (!compare(opcode, false, a, data, carry != 0, out, failures))
+						++failures;
+
+		for (unsigned long sample = 0; sample < SAMPLES; ++sample, ++tests) {
+			seed = (seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+			Word	a = (Word)(seed >> 8);
+			seed = (seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+			Word	data = (Word)(seed >> 8);
+
+			if (!compare(opcode, true, a, data, (sample & 1) != 0, out, failures))
+				++failures;
+		}
+	}
+
+	out << "Decimal ADC/SBC: " << tests << " cases, " << failures << " mismatches" << endl;
+	return (failures);
+}
+
+//==============================================================================
+// Opcode Table
+//------------------------------------------------------------------------------
+
+// Test if an opcode may leave the PC anywhere but the next instruction:
+// interrupts, jumps, calls, returns, unconditional branches, WAI and STP
+static bool isTransfer(wdc816::Byte opcode)
+{
+	switch (opcode) {
+	case 0x00: case 0x02: case 0x20: case 0x22: case 0x40: case 0x4c:
+	case 0x5c: case 0x60: case 0x6b: case 0x6c: case 0x7c: case 0x80:
+	case 0x82: case 0xcb: case 0xdb: case 0xdc: case 0xfc:
+		return (true);
+	}
+	return (false);
+}
+
+// Run each opcode in each mode from a clean page zero and stack. Branches are
+// given the flags that make them fall through. Each status flag the table
+// says is not read is then inverted in turn, which must change nothing but
+// that flag, and the flags changed from two different starting values must
+// all be ones the table says are written.
+unsigned long check816::opcodes(ostream &out)
+{
+	static const struct {
+		const char	   *name;
+		bool			e, m, x;
+	} modes[] = {
+		{ "E", true, true, true },
+		{ "M8X8", false, true, true },
+		{ "M8X16", false, true, false },
+		{ "M16X8", false, false, true },
+		{ "M16X16", false, false, false }
+	};
+
+	unsigned long	tests = 0;
+	unsigned long	failures = 0;
+	Byte			memory[MEMORY];
+	Byte			other[MEMORY];
+
+	emu816::setFusion(false);
+
+	for (unsigned int mode = 0; mode < 5; ++mode)
+		for (unsigned int opcode = 0; opcode < 0x100; ++opcode, ++tests) {
+			const op816::Info  &info = op816::table[opcode];
+			bool				e = modes[mode].e;
+			bool				m = modes[mode].m;
+			bool				x = modes[mode].x;
+			Byte				flags = (m ? 0x20 : 0x00) | (x ? 0x10 : 0x00);
+
+			// A conditional branch tests a flag against bit 5 of its opcode
+			if ((info.mode == op816::RELA) && !isTransfer(opcode)
+					&& !(opcode & 0x20))
+				flags |= info.reads;
+
+			emu816::State	state;
+			emu816::State	changed;
+
+			run(e, opcode, flags, state, memory);
+
+			unsigned int	length = op816::length(opcode, m, x);
+			unsigned int	expected = e
+				? op816::emulationCycles(opcode) : op816::cycles(opcode, m, x);
+			bool			lengthOK = isTransfer(opcode)
+				|| (state.pc == ORIGIN + length);
+			Byte			inverse = (flags ^ (Byte) ~info.reads)
+				| (e ? 0x30 : 0x00);
+			Byte			unread = 0;
+			Byte			unwritten = (state.p ^ flags) & ~info.writes;
+
+			for (Byte flag = 0x01; flag != 0x00; flag <<= 1) {
+				if ((flag & info.reads) != 0) continue;
+
+				run(e, opcode, flags ^ flag, changed, other);
+				if (!same(state, memory, changed, other, flag)) unread |= flag;
+			}
+
+			run(e, opcode, inverse, changed, other);
+			unwritten |= (changed.p ^ inverse) & ~info.writes;
+
+			if (lengthOK && (state.cycles == expected) && !unread && !unwritten)
+				continue;
+
+			if (failures++ < REPORT) {
+				out << toHex(opcode, 2) << ' ' << info.mnemonic << " in "
+					<< modes[mode].name << ":";
+				if (!lengthOK)
+					out << " length " << (Word)(state.pc - ORIGIN) << " not " << length;
+				if (state.cycles != expected)
+					out << " cycles " << state.cycles << " not " << expected;
+				if (unread)
+					out << " reads P=" << toHex(unread, 2) << " not in table";
+				if (unwritten)
+					out << " writes P=" << toHex(unwritten, 2) << " not in table";
+				out << endl;
+			}
+		}
+
+	out << "Opcode table: " << tests << " cases, " << failures << " mismatches" << endl;
+	return (failures);
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef CHECK816_H
+#define CHECK816_H
+
+#include <iostream>
+
+#include "wdc816.h"
+
+// The check816 class holds self-tests that execute instructions on the
+// emulator and compare the results with an independent reference, so that
+// optimisations of the interpreter can be shown not to change its behaviour.
+// Each check writes a line per mismatch (up to a limit) and a summary, and
+// returns the number of mismatches found.
+
+class check816 :
+	public wdc816
+{
+public:
+	// Compare decimal mode ADC and SBC with the original nibble by nibble
+	// correction for every 8-bit accumulator, operand and carry, and for a
+	// fixed sample of 16-bit values.
+	static unsigned long decimal(std::ostream &out);
+
+	// Execute every opcode in emulation mode and in native mode with each
+	// width of the accumulator and index registers, comparing the distance
+	// the PC moves, the cycles charged and the status flags read and written
+	// with the op816 table. Only instructions that fall through to the next
+	// are checked for length. Registers and memory start clear, so a flag
+	// that only matters for other values is not seen to be read.
+	static unsigned long opcodes(std::ostream &out);
+
+private:
+	check816();
+	~check816();
+
+	static bool execute(Byte opcode, bool wide, Word a, Word data, bool carry,
+		Word &result, Byte &flags);
+	static bool compare(Byte opcode, bool wide, Word a, Word data, bool carry,
+		std::ostream &out, unsigned long failures);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,241 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <iostream>
+
+using namespace std;
+
+#include "dis816.h"
+#include "mem816.h"
+#include "op816.h"
+
+//==============================================================================
+
+// Never used.
+dis816::dis816()
+{ }
+
+// Never used.
+dis816::~dis816()
+{ }
+
+//==============================================================================
+// Text Helpers
+//------------------------------------------------------------------------------
+
+// Append a string
+static char *put(char *out, const char *text)
+{
+	while (*text) *out++ = *text++;
+	return (out);
+}
+
+// Append a value as hex digits
+static char *hex(char *out, unsigned long value, unsigned int digits)
+{
+	for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+		*out++ = "0123456789ABCDEF"[(value >> shift) & 0xf];
+	return (out);
+}
+
+// Append a value as an assembler hex constant
+static char *imm(char *out, unsigned long value, unsigned int digits)
+{
+	*out++ = '$';
+	return (hex(out, value, digits));
+}
+
+// Append a value in decimal
+static char *dec(char *out, unsigned long long value)
+{
+	char	digits[24];
+	int		count = 0;
+
+	do {
+		digits[count++] = (char)('0' + value % 10);
+	} while (value /= 10);
+
+	while (count > 0) *out++ = digits[--count];
+	return (out);
+}
+
+// Append a register, bracketing the byte in use as the trace does
+static char *reg(char *out, const char *name, unsigned int value, bool narrow)
+{
+	out = put(out, name);
+	if (narrow) {
+		out = hex(out, value >> 8, 2);
+		*out++ = '[';
+	}
+	else {
+		*out++ = '[';
+		out = hex(out, value >> 8, 2);
+	}
+	out = hex(out, value & 0xff, 2);
+	*out++ = ']';
+	return (out);
+}
+
+//==============================================================================
+// Disassembly
+//------------------------------------------------------------------------------
+
+// Decode a single instruction
+unsigned int dis816::decode(Addr addr, const Byte *bytes, bool &m, bool &x,
+	char *text)
+{
+	const op816::Info  &info = op816::table[bytes[0]];
+	unsigned int		len = op816::length(bytes[0], m, x);
+	unsigned long		value = bytes[1] | (bytes[2] << 8);
+	char			   *out = put(text, info.mnemonic);
+
+	if (info.mode != op816::IMPL) *out++ = ' ';
+
+	switch (info.mode) {
+	case op816::ABSL:	out = imm(out, value, 4); break;
+	case op816::ABSX:	out = put(imm(out, value, 4), ",X"); break;
+	case op816::ABSY:	out = put(imm(out, value, 4), ",Y"); break;
+	case op816::ABSI:	out = put(imm(put(out, "("), value, 4), ")"); break;
+	case op816::ABXI:	out = put(imm(put(out, "("), value, 4), ",X)"); break;
+	case op816::ALNG:	out = imm(out, value | (bytes[3] << 16), 6); break;
+	case op816::ALNX:	out = put(imm(out, value | (bytes[3] << 16), 6), ",X"); break;
+	case op816::ABIL:	out = put(imm(put(out, "["), value, 4), "]"); break;
+	case op816::DPAG:	out = imm(out, bytes[1], 2); break;
+	case op816::DPGX:	out = put(imm(out, bytes[1], 2), ",X"); break;
+	case op816::DPGY:	out = put(imm(out, bytes[1], 2), ",Y"); break;
+	case op816::DPGI:	out = put(imm(put(out, "("), bytes[1], 2), ")"); break;
+	case op816::DPIX:	out = put(imm(put(out, "("), bytes[1], 2), ",X)"); break;
+	case op816::DPIY:	out = put(imm(put(out, "("), bytes[1], 2), "),Y"); break;
+	case op816::DPIL:	out = put(imm(put(out, "["), bytes[1], 2), "]"); break;
+	case op816::DILY:	out = put(imm(put(out, "["), bytes[1], 2), "],Y"); break;
+	case op816::IMPL:	break;
+	case op816::ACC:	*out++ = 'A'; break;
+	case op816::IMMB:	out = imm(put(out, "#"), bytes[1], 2); break;
+	case op816::IMMM:
+	case op816::IMMX:	out = imm(put(out, "#"), value, (len - 1) * 2); break;
+	case op816::SREL:	out = put(imm(out, bytes[1], 2), ",S"); break;
+	case op816::SRIY:	out = put(imm(put(out, "("), bytes[1], 2), ",S),Y"); break;
+
+	case op816::IMMW:
+		// MVN/MVP are written source bank first but encoded destination first
+		if ((bytes[0] == 0x44) || (bytes[0] == 0x54))
+			out = imm(put(imm(out, bytes[2], 2), ","), bytes[1], 2);
+		else
+			out = imm(out, value, 4);
+		break;
+
+	case op816::RELA:
+		out = imm(out, (Word)(addr + 2 + (signed char) bytes[1]), 4);
+		break;
+
+	case op816::LREL:
+		out = imm(out, (Word)(addr + 3 + value), 4);
+		break;
+	}
+	*out = 0;
+
+	// Track the register widths
+	if (bytes[0] == 0xc2) {
+		if (bytes[1] & 0x20) m = false;
+		if (bytes[1] & 0x10) x = false;
+	}
+	if (bytes[0] == 0xe2) {
+		if (bytes[1] & 0x20) m = true;
+		if (bytes[1] & 0x10) x = true;
+	}
+	return (len);
+}
+
+// Format the address, bytes and text of an instruction as the trace does
+char *dis816::line(char *out, Addr addr, const Byte *bytes, unsigned int len,
+	const char *text)
+{
+	out = hex(out, addr >> 16, 2);
+	*out++ = ':';
+	out = hex(out, addr & 0xffff, 4);
+
+	for (unsigned int index = 0; index < 4; ++index) {
+		*out++ = ' ';
+		if (index < len)
+			out = hex(out, bytes[index], 2);
+		else
+			out = put(out, "  ");
+	}
+	*out++ = ' ';
+	out = put(out, text);
+	*out = 0;
+	return (out);
+}
+
+// List a range of memory
+dis816::Addr dis816::list(Addr start, Addr end, bool &m, bool &x, ostream &out)
+{
+	char	text[TEXT_SIZE];
+	char	buffer[LINE_SIZE];
+	Byte	bytes[4];
+
+	while (start < end) {
+		for (unsigned int index = 0; index < 4; ++index)
+			bytes[index] = mem816::getByte(join(start >> 16, (Word)(start + index)));
+
+		unsigned int len = decode(start, bytes, m, x, text);
+
+		line(buffer, start, bytes, len, text);
+		out << buffer << endl;
+		start = join(start >> 16, (Word)(start + len));
+		if ((Word) start < len) break;			// Wrapped at the end of the bank
+	}
+	return (start);
+}
+
+// Render a trace record
+void dis816::render(const trace816::Record &record, char *text)
+{
+	bool	m = record.e || (record.p & 0x20);
+	bool	x = record.e || (record.p & 0x10);
+	char	inst[TEXT_SIZE];
+	char   *out;
+
+	unsigned int len = decode(join(record.pbr, record.pc), record.bytes, m, x, inst);
+
+	m = record.e || (record.p & 0x20);
+	x = record.e || (record.p & 0x10);
+
+	out = line(text, join(record.pbr, record.pc), record.bytes, len, inst);
+	while (out < text + 40) *out++ = ' ';
+
+	out = put(out, "E=");
+	*out++ = record.e ? '1' : '0';
+	out = put(out, " P=");
+	for (unsigned int bit = 0; bit < 8; ++bit)
+		*out++ = (record.p & (0x80 >> bit)) ? "NVMXDIZC"[bit] : '.';
+	out = reg(out, " A=", record.a, m);
+	out = reg(out, " X=", record.x, x);
+	out = reg(out, " Y=", record.y, x);
+	out = put(out, " DP=");
+	out = hex(out, record.dp, 4);
+	out = reg(out, " SP=", record.sp, record.e != 0);
+	out = put(out, " DBR=");
+	out = hex(out, record.dbr, 2);
+	out = put(out, " CYC=");
+	out = dec(out, record.cycles);
+	*out = 0;
+}
\ No newline at end of file
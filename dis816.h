@@ -0,0 +1,63 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef DIS816_H
+#define DIS816_H
+
+#include <iostream>
+
+#include "trace816.h"
+
+// The dis816 class turns instruction bytes into assembler text using the
+// opcode table in op816. It works into caller supplied buffers and never
+// allocates, so it can be used on the fly or afterwards on recorded trace.
+// Like an assembler's .longa and .longi directives, the caller tracks the
+// accumulator and index register widths, which REP and SEP update.
+
+class dis816 :
+	public wdc816
+{
+public:
+	enum {
+		TEXT_SIZE = 32,					// Room for one decoded instruction
+		LINE_SIZE = 160					// Room for a listing or trace line
+	};
+
+	// Decode the instruction in bytes (at least four) located at addr into
+	// text, returning its length
+	static unsigned int decode(Addr addr, const Byte *bytes, bool &m, bool &x,
+		char *text);
+
+	// Write a listing of guest memory from start up to end, returning the
+	// address following the last instruction
+	static Addr list(Addr start, Addr end, bool &m, bool &x, std::ostream &out);
+
+	// Format a trace record as an instruction and register line
+	static void render(const trace816::Record &record, char *line);
+
+private:
+	dis816();
+	~dis816();
+
+	static char *line(char *out, Addr addr, const Byte *bytes, unsigned int len,
+		const char *text);
+};
+#endif
\ No newline at end of file
@@ -30,24 +30,86 @@ using namespace std;
 
 #include "emu816.h"
 
-union emu816::FLAGS		emu816::p;
-
-emu816::Bit				emu816::e;
-
-union emu816::REGS		emu816::a;
-union emu816::REGS		emu816::x;
-union emu816::REGS		emu816::y;
-union emu816::REGS		emu816::sp;
-union emu816::REGS		emu816::dp;
-
-emu816::Word			emu816::pc;
-emu816::Byte			emu816::pbr;
-emu816::Byte			emu816::dbr;
+THREAD_LOCAL union emu816::FLAGS	emu816::p;
+
+THREAD_LOCAL emu816::Bit		emu816::e;
+
+THREAD_LOCAL union emu816::REGS	emu816::a;
+THREAD_LOCAL union emu816::REGS	emu816::x;
+THREAD_LOCAL union emu816::REGS	emu816::y;
+THREAD_LOCAL union emu816::REGS	emu816::sp;
+THREAD_LOCAL union emu816::REGS	emu816::dp;
+
+THREAD_LOCAL emu816::Word		emu816::pc;
+THREAD_LOCAL emu816::Byte		emu816::pbr;
+THREAD_LOCAL emu816::Byte		emu816::dbr;
+THREAD_LOCAL emu816::Addr		emu816::instPC;
+THREAD_LOCAL bool				emu816::watching;
+THREAD_LOCAL bool				emu816::observed;
+
+THREAD_LOCAL bool				emu816::stopped;
+THREAD_LOCAL bool				emu816::interrupted;
+THREAD_LOCAL bool				emu816::waiting;
+THREAD_LOCAL unsigned long long	emu816::cycles;
+THREAD_LOCAL unsigned long long	emu816::latched;
+THREAD_LOCAL unsigned long		emu816::instructions;
+THREAD_LOCAL unsigned long		emu816::modeSwitches;
+THREAD_LOCAL unsigned long		emu816::interrupts;
+THREAD_LOCAL emu816::Addr		emu816::breakAt = NO_BREAK;
+THREAD_LOCAL bool				emu816::paused;
+THREAD_LOCAL bool				emu816::trace;
+THREAD_LOCAL unsigned long long	emu816::horizon = ~0ULL;
+
+bool							emu816::fusion = true;
+
+THREAD_LOCAL emu816::Byte	   *emu816::pCoverage;
+THREAD_LOCAL emu816::Word		emu816::lastEdge;
+THREAD_LOCAL trace816		   *emu816::pTrace;
+
+#ifndef CHIPKIT
+THREAD_LOCAL istream		   *emu816::pIn = &cin;
+THREAD_LOCAL ostream		   *emu816::pOut = &cout;
+THREAD_LOCAL journal816	   *emu816::pJournal;
+THREAD_LOCAL region816	   *emu816::pRegions;
+#endif
 
-bool					emu816::stopped;
-bool					emu816::interrupted;
-unsigned long			emu816::cycles;
-bool					emu816::trace;
+// The decimal adjustment to add to a binary sum for each value of its low byte.
+// Applying it to the low byte (and then to the high byte of a 16-bit sum) is
+// equivalent to correcting each nibble in turn, lowest first.
+const emu816::Byte	emu816::bcdAdjust[256] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+	0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60,
+	0x60, 0x60, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+	0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60,
+	0x60, 0x60, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+	0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60,
+	0x60, 0x60, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+	0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60,
+	0x60, 0x60, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+	0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60,
+	0x60, 0x60, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+	0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60,
+	0x60, 0x60, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06
+};
 
 //==============================================================================
 
@@ -72,18 +134,124 @@ void emu816::reset(bool trace)
 
 	stopped = false;
 	interrupted = false;
+	waiting = false;
+	cycles = 0;
+	latched = 0;
+	instructions = 0;
+	modeSwitches = 0;
+	interrupts = 0;
+	breakAt = NO_BREAK;
+	paused = false;
 	
 	emu816::trace = trace;
 }
 
+// Execute instructions until the cycle budget is used or the processor stops
+// or parks itself in a WAI or STP.
+void emu816::run(unsigned long budget)
+{
+	unsigned long long limit = cycles + budget;
+
+	horizon = limit;
+	while (!stopped && !waiting && (cycles < limit))
+		step();
+	horizon = ~0ULL;
+}
+
+// Capture the processor state
+void emu816::save(State &state)
+{
+	state.p = p.b;
+	state.e = e;
+	state.a = a.w;
+	state.x = x.w;
+	state.y = y.w;
+	state.sp = sp.w;
+	state.dp = dp.w;
+	state.pc = pc;
+	state.pbr = pbr;
+	state.dbr = dbr;
+	state.stopped = stopped;
+	state.interrupted = interrupted;
+	state.waiting = waiting;
+	state.cycles = cycles;
+	state.latched = latched;
+	state.instructions = instructions;
+	state.modeSwitches = modeSwitches;
+	state.interrupts = interrupts;
+	state.trace = trace;
+}
+
+// Reinstate a previously captured processor state
+void emu816::restore(const State &state)
+{
+	p.b = state.p;
+	e = state.e;
+	a.w = state.a;
+	x.w = state.x;
+	y.w = state.y;
+	sp.w = state.sp;
+	dp.w = state.dp;
+	pc = state.pc;
+	pbr = state.pbr;
+	dbr = state.dbr;
+	stopped = state.stopped;
+	interrupted = state.interrupted;
+	waiting = state.waiting;
+	cycles = state.cycles;
+	latched = state.latched;
+	instructions = state.instructions;
+	modeSwitches = state.modeSwitches;
+	interrupts = state.interrupts;
+	trace = state.trace;
+}
+
+#ifndef CHIPKIT
+// Store a raw trace record of the state before the next instruction
+void emu816::capture()
+{
+	trace816::Record &record = pTrace->next();
+
+	record.cycles = cycles;
+	record.pc = pc;
+	record.a = a.w;
+	record.x = x.w;
+	record.y = y.w;
+	record.sp = sp.w;
+	record.dp = dp.w;
+	record.pbr = pbr;
+	record.dbr = dbr;
+	record.p = p.b;
+	record.e = e;
+	for (unsigned int index = 0; index < 4; ++index)
+		record.bytes[index] = getByte(join(pbr, (Word)(pc + index)));
+}
+#endif
+
+// Start or stop watching memory, noting the address of each instruction for
+// the watcher while it is on
+void emu816::setWatches(const vector<Watch> *watches, Watcher watcher)
+{
+	mem816::setWatches(watches, watcher);
+	watching = (watches != NULL) && !watches->empty();
+	observed = watching || (pTrace != NULL);
+}
+
 // Execute a single instruction or invoke an interrupt
 void emu816::step()
 {
 	// Check for NMI/IRQ
 
 	SHOWPC();
+	if (observed) {
+		instPC = join(pbr, pc);
+#ifndef CHIPKIT
+		if (pTrace) capture();
+#endif
+	}
 
-	switch (getByte (join(pbr, pc++))) {
+	++instructions;
+	switch (getOpcode(join(pbr, pc++))) {
 	case 0x00:	op_brk(am_immb());	break;
 	case 0x01:	op_ora(am_dpix());	break;
 	case 0x02:	op_cop(am_immb());	break;
@@ -109,7 +277,7 @@ void emu816::step()
 	case 0x15:	op_ora(am_dpgx());	break;
 	case 0x16:	op_asl(am_dpgx());	break;
 	case 0x17:	op_ora(am_dily());	break;
-	case 0x18:	op_clc(am_impl());	break;
+	case 0x18:	op_clc(am_impl());	fuseAdd();	break;
 	case 0x19:	op_ora(am_absy());	break;
 	case 0x1a:	op_inca(am_acc());	break;
 	case 0x1b:	op_tcs(am_impl());	break;
@@ -143,7 +311,7 @@ void emu816::step()
 	case 0x35: 	op_and(am_dpgx());	break;
 	case 0x36:	op_rol(am_dpgx());	break;
 	case 0x37: 	op_and(am_dily());	break;
-	case 0x38:	op_sec(am_impl());	break;
+	case 0x38:	op_sec(am_impl());	fuseSubtract();	break;
 	case 0x39: 	op_and(am_absy());	break;
 	case 0x3a:	op_deca(am_acc());	break;
 	case 0x3b:	op_tsc(am_impl());	break;
@@ -228,7 +396,7 @@ void emu816::step()
 	case 0x85:	op_sta(am_dpag());	break;
 	case 0x86:	op_stx(am_dpag());	break;
 	case 0x87:	op_sta(am_dpil());	break;
-	case 0x88:	op_dey(am_impl());	break;
+	case 0x88:	if (!countLoop(y, -1)) { op_dey(am_impl()); fuseBranch(); } break;
 	case 0x89:	op_biti(am_immm());	break;
 	case 0x8a:	op_txa(am_impl());	break;
 	case 0x8b:	op_phb(am_impl());	break;
@@ -259,15 +427,15 @@ void emu816::step()
 	case 0xa2:	op_ldx(am_immx());	break;
 	case 0xa3:	op_lda(am_srel());	break;
 	case 0xa4:	op_ldy(am_dpag());	break;
-	case 0xa5:	op_lda(am_dpag());	break;
+	case 0xa5:	op_lda(am_dpag());	fuseStore();	break;
 	case 0xa6:	op_ldx(am_dpag());	break;
 	case 0xa7:	op_lda(am_dpil());	break;
 	case 0xa8:	op_tay(am_impl());	break;
-	case 0xa9:	op_lda(am_immm());	break;
+	case 0xa9:	op_lda(am_immm());	fuseStore();	break;
 	case 0xaa:	op_tax(am_impl());	break;
 	case 0xab:	op_plb(am_impl());	break;
 	case 0xac:	op_ldy(am_absl());	break;
-	case 0xad:	op_lda(am_absl());	break;
+	case 0xad:	op_lda(am_absl());	fuseStore();	break;
 	case 0xae:	op_ldx(am_absl());	break;
 	case 0xaf:	op_lda(am_alng());	break;
 
@@ -288,7 +456,7 @@ void emu816::step()
 	case 0xbe:	op_ldx(am_absy());	break;
 	case 0xbf:	op_lda(am_alnx());	break;
 
-	case 0xc0:	op_cpy(am_immx());	break;
+	case 0xc0:	op_cpy(am_immx());	fuseBranch();	break;
 	case 0xc1:	op_cmp(am_dpix());	break;
 	case 0xc2:	op_rep(am_immb());	break;
 	case 0xc3:	op_cmp(am_srel());	break;
@@ -296,9 +464,9 @@ void emu816::step()
 	case 0xc5:	op_cmp(am_dpag());	break;
 	case 0xc6:	op_dec(am_dpag());	break;
 	case 0xc7:	op_cmp(am_dpil());	break;
-	case 0xc8:	op_iny(am_impl());	break;
-	case 0xc9:	op_cmp(am_immm());	break;
-	case 0xca:	op_dex(am_impl());	break;
+	case 0xc8:	if (!countLoop(y, +1)) { op_iny(am_impl()); fuseBranch(); } break;
+	case 0xc9:	op_cmp(am_immm());	fuseBranch();	break;
+	case 0xca:	if (!countLoop(x, -1)) { op_dex(am_impl()); fuseBranch(); } break;
 	case 0xcb:	op_wai(am_impl());	break;
 	case 0xcc:	op_cpy(am_absl());	break;
 	case 0xcd:	op_cmp(am_absl());	break;
@@ -322,7 +490,7 @@ void emu816::step()
 	case 0xde:	op_dec(am_absx());	break;
 	case 0xdf:	op_cmp(am_alnx());	break;
 
-	case 0xe0:	op_cpx(am_immx());	break;
+	case 0xe0:	op_cpx(am_immx());	fuseBranch();	break;
 	case 0xe1:	op_sbc(am_dpix());	break;
 	case 0xe2:	op_sep(am_immb());	break;
 	case 0xe3:	op_sbc(am_srel());	break;
@@ -330,7 +498,7 @@ void emu816::step()
 	case 0xe5:	op_sbc(am_dpag());	break;
 	case 0xe6:	op_inc(am_dpag());	break;
 	case 0xe7:	op_sbc(am_dpil());	break;
-	case 0xe8:	op_inx(am_impl());	break;
+	case 0xe8:	if (!countLoop(x, +1)) { op_inx(am_impl()); fuseBranch(); } break;
 	case 0xe9:	op_sbc(am_immm());	break;
 	case 0xea:	op_nop(am_impl());	break;
 	case 0xeb:	op_xba(am_impl());	break;
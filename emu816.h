@@ -24,6 +24,14 @@
 
 #include "mem816.h"
 
+#ifndef CHIPKIT
+#include "journal816.h"
+#include "region816.h"
+#include "trace816.h"
+#else
+class trace816;
+#endif
+
 #include <stdlib.h>
 
 #if 1
@@ -42,24 +50,186 @@
 # define ENDL()
 #endif
 
-// Defines the WDC 65C816 emulator. 
+// Defines the WDC 65C816 emulator. The processor state is held per thread so
+// that a pool of worker threads can each run an independent emulator.
 class emu816 :
 	public mem816
 {
 public:
+	// The complete processor state of a guest, used to move it between threads
+	struct State {
+		Byte			p;
+		Bit				e;
+		Word			a, x, y, sp, dp;
+		Word			pc;
+		Byte			pbr, dbr;
+		bool			stopped;
+		bool			interrupted;
+		bool			waiting;
+		unsigned long long cycles;
+		unsigned long long latched;	// Counter copied by WDM #$12
+		unsigned long	instructions;
+		unsigned long	modeSwitches;
+		unsigned long	interrupts;
+		bool			trace;
+	};
+
 	static void reset(bool trace);
 	static void step();
+	static void run(unsigned long budget);
+
+	static void save(State &state);
+	static void restore(const State &state);
 
-	INLINE static unsigned long getCycles()
+	INLINE static unsigned long long getCycles()
 	{
 		return (cycles);
 	}
 
+	// The number of instructions executed since the last reset
+	INLINE static unsigned long getInstructions()
+	{
+		return (instructions);
+	}
+
+	// The number of REP, SEP and XCE instructions that changed the register
+	// widths or processor mode since the last reset
+	INLINE static unsigned long getModeSwitches()
+	{
+		return (modeSwitches);
+	}
+
+	// The number of interrupts signalled and BRK or COP instructions executed
+	// since the last reset
+	INLINE static unsigned long getInterrupts()
+	{
+		return (interrupts);
+	}
+
+	// The full address of the next instruction
+	INLINE static Addr getPC()
+	{
+		return (join(pbr, pc));
+	}
+
+	// The full address of the instruction being executed. This is only kept
+	// up to date whilst watching memory or tracing.
+	INLINE static Addr getInstPC()
+	{
+		return (instPC);
+	}
+
+	// The address of the breakpoint that stopped the processor, or NO_BREAK
+	enum { NO_BREAK = 0xffffffff };
+
+	INLINE static Addr getBreak()
+	{
+		return (breakAt);
+	}
+
+	// Stop once the current instruction completes, as a debugger does when a
+	// watched location is accessed
+	INLINE static void pause()
+	{
+		paused = stopped = true;
+	}
+
+	INLINE static bool isPaused()
+	{
+		return (paused);
+	}
+
+	// Continue from a breakpoint, executing the original instruction there,
+	// or from a pause
+	INLINE static void resume()
+	{
+		if (breakAt != NO_BREAK) {
+			stepOver(breakAt);
+			breakAt = NO_BREAK;
+			stopped = false;
+		}
+		if (paused) {
+			paused = false;
+			stopped = false;
+		}
+	}
+
 	INLINE static bool isStopped()
 	{
 		return (stopped);
 	}
 
+	// Is the processor parked in a WAI or STP awaiting an interrupt?
+	INLINE static bool isWaiting()
+	{
+		return (waiting);
+	}
+
+	// Signal an interrupt, releasing a processor held in WAI or STP
+	INLINE static void interrupt()
+	{
+#ifndef CHIPKIT
+		if (pJournal) pJournal->interrupt(cycles);
+#endif
+		interrupted = true;
+		waiting = false;
+		++interrupts;
+	}
+
+	// Enable or disable the fusing of common instruction sequences into one
+	// dispatch. This applies to every thread and defaults to enabled.
+	INLINE static void setFusion(bool enable)
+	{
+		fusion = enable;
+	}
+
+	INLINE static bool isFusing()
+	{
+		return (fusion);
+	}
+
+	// The size of an edge coverage map
+	enum { COVERAGE_SIZE = 1 << 16 };
+
+	// Record AFL style edge coverage into a map, or stop if NULL
+	INLINE static void setCoverage(Byte *map)
+	{
+		pCoverage = map;
+		lastEdge = 0;
+	}
+
+#ifndef CHIPKIT
+	// Redirect the WDM console streams for this thread's emulator
+	INLINE static void setConsole(istream *in, ostream *out)
+	{
+		pIn = in;
+		pOut = out;
+	}
+
+	// Record or replay the guest's inputs through a journal, or stop if NULL
+	INLINE static void setJournal(journal816 *journal)
+	{
+		pJournal = journal;
+	}
+
+	// Capture a raw record of each instruction executed, or stop if NULL
+	INLINE static void setTrace(trace816 *trace)
+	{
+		pTrace = trace;
+		observed = watching || (pTrace != NULL);
+	}
+
+	// Watch accesses to ranges of memory, or stop if NULL. Whilst watching the
+	// address of each instruction is noted for the watcher.
+	static void setWatches(const std::vector<Watch> *watches, Watcher watcher);
+
+	// Collect the timings of regions marked by WDM #$10/$11, or stop if NULL
+	INLINE static void setRegions(region816 *regions)
+	{
+		pRegions = regions;
+	}
+#endif
+
 private:
 	static union FLAGS {
 		struct {
@@ -73,22 +243,49 @@ private:
 			Bit				f_n : 1;
 		};
 		Byte			b;
-	}   p;
+	}   THREAD_LOCAL p;
 
-	static Bit		e;
+	static THREAD_LOCAL Bit		e;
 
 	static union REGS {
 		Byte			b;
 		Word			w;
-	}   a, x, y, sp, dp;
-
-	static Word		pc;
-	static Byte		pbr, dbr;
-
-	static bool		stopped;
-	static bool		interrupted;
-	static unsigned long cycles;
-	static bool		trace;
+	}   THREAD_LOCAL a, x, y, sp, dp;
+
+	static THREAD_LOCAL Word	pc;
+	static THREAD_LOCAL Byte	pbr, dbr;
+	static THREAD_LOCAL Addr	instPC;
+	static THREAD_LOCAL bool	watching;
+	static THREAD_LOCAL bool	observed;		// Watching or tracing
+
+	static THREAD_LOCAL bool	stopped;
+	static THREAD_LOCAL bool	interrupted;
+	static THREAD_LOCAL bool	waiting;
+	static THREAD_LOCAL unsigned long long cycles;
+	static THREAD_LOCAL unsigned long long latched;
+	static THREAD_LOCAL unsigned long instructions;
+	static THREAD_LOCAL unsigned long modeSwitches;
+	static THREAD_LOCAL unsigned long interrupts;
+	static THREAD_LOCAL Addr	breakAt;
+	static THREAD_LOCAL bool	paused;
+	static THREAD_LOCAL bool	trace;
+	static THREAD_LOCAL unsigned long long horizon;
+
+	static bool					fusion;
+	static const Byte			bcdAdjust[256];
+
+	static THREAD_LOCAL Byte   *pCoverage;
+	static THREAD_LOCAL Word	lastEdge;
+
+#ifndef CHIPKIT
+	static THREAD_LOCAL istream *pIn;
+	static THREAD_LOCAL ostream *pOut;
+	static THREAD_LOCAL journal816 *pJournal;
+	static THREAD_LOCAL region816 *pRegions;
+
+	static void capture();
+#endif
+	static THREAD_LOCAL trace816 *pTrace;
 
 	emu816();
 	~emu816();
@@ -97,6 +294,120 @@ private:
 	static void bytes(unsigned int);
 	static void dump(const char *, Addr);
 
+	// Count a branch, jump, call or return in the coverage map. Each target
+	// (or fall through of an untaken branch) is hashed and combined with the
+	// previous one to identify the edge.
+	INLINE static void edge()
+	{
+		if (pCoverage) {
+			Word	here = (Word)((join(pbr, pc) * 0x9e3779b1UL) >> 16);
+
+			++pCoverage[here ^ lastEdge];
+			lastEdge = here >> 1;
+		}
+	}
+
+	// Superinstructions. After executing certain instructions step() checks if
+	// the next is one commonly paired with it and if so executes it without a
+	// further dispatch. The handlers are the ordinary ones so the results and
+	// cycle counts are unchanged. Nothing is fused while tracing, so that
+	// every instruction is seen.
+
+	// Fuse a conditional branch after a counter update or comparison
+	INLINE static void fuseBranch()
+	{
+		if (fusion && !trace && !pTrace) {
+			switch (getOpcode(join(pbr, pc))) {
+			case 0x90:	++pc; ++instructions; op_bcc(am_rela()); break;
+			case 0xb0:	++pc; ++instructions; op_bcs(am_rela()); break;
+			case 0xd0:	++pc; ++instructions; op_bne(am_rela()); break;
+			case 0xf0:	++pc; ++instructions; op_beq(am_rela()); break;
+			}
+		}
+	}
+
+	// Fuse a store of the accumulator after a load or arithmetic
+	INLINE static void fuseStore()
+	{
+		if (fusion && !trace && !pTrace) {
+			switch (getOpcode(join(pbr, pc))) {
+			case 0x85:	++pc; ++instructions; op_sta(am_dpag()); break;
+			case 0x8d:	++pc; ++instructions; op_sta(am_absl()); break;
+			case 0x9d:	++pc; ++instructions; op_sta(am_absx()); break;
+			}
+		}
+	}
+
+	// Fuse an ADC (and any following store) after a CLC
+	INLINE static void fuseAdd()
+	{
+		if (fusion && !trace && !pTrace) {
+			switch (getOpcode(join(pbr, pc))) {
+			case 0x65:	++pc; ++instructions; op_adc(am_dpag()); fuseStore(); break;
+			case 0x69:	++pc; ++instructions; op_adc(am_immm()); fuseStore(); break;
+			case 0x6d:	++pc; ++instructions; op_adc(am_absl()); fuseStore(); break;
+			}
+		}
+	}
+
+	// Fuse an SBC (and any following store) after a SEC
+	INLINE static void fuseSubtract()
+	{
+		if (fusion && !trace && !pTrace) {
+			switch (getOpcode(join(pbr, pc))) {
+			case 0xe5:	++pc; ++instructions; op_sbc(am_dpag()); fuseStore(); break;
+			case 0xe9:	++pc; ++instructions; op_sbc(am_immm()); fuseStore(); break;
+			case 0xed:	++pc; ++instructions; op_sbc(am_absl()); fuseStore(); break;
+			}
+		}
+	}
+
+	// Execute a DEX/DEY/INX/INY followed by a BNE back to itself in closed
+	// form. The counter runs to zero, taking as many iterations as its value
+	// (or distance below zero when counting up), and the final register, flags
+	// and cycles are set directly. If the iterations would run past the cycle
+	// budget of run() it stops at the first whole iteration to do so, where
+	// stepping one iteration at a time would have stopped. Returns false if the
+	// instruction does not start such a loop.
+	INLINE static bool countLoop(union REGS &r, int delta)
+	{
+		if (!fusion || trace || pTrace || pCoverage) return (false);
+		if ((getOpcode(join(pbr, pc)) != 0xd0) ||
+			(getCodeByte(join(pbr, (Word)(pc + 1))) != 0xfd)) return (false);
+		if (isBreakpoint(join(pbr, (Word)(pc - 1)))) return (false);
+
+		Word			start = pc - 1;
+		bool			narrow = e || p.f_x;
+		unsigned long	size = narrow ? 0x100 : 0x10000;
+		unsigned long	value = narrow ? r.b : r.w;
+		unsigned long	count = ((delta < 0) ? value : size - value) & (size - 1);
+		unsigned long	span = (e && (((Word)(pc + 2) ^ start) & 0xff00)) ? 7 : 6;
+		unsigned long long avail = (horizon > cycles) ? horizon - cycles : 0;
+		unsigned long long fit = (avail + span - 1) / span;
+
+		if (count == 0) count = size;
+		if (fit == 0) fit = 1;
+
+		if (fit < count) {
+			value = (value + ((delta < 0) ? size - fit : fit)) & (size - 1);
+			cycles += fit * span;
+			instructions += 2 * fit - 1;
+			pc = start;
+		}
+		else {
+			value = 0;
+			cycles += (count - 1) * span + 5;
+			instructions += 2 * count - 1;
+			pc += 2;
+		}
+
+		if (narrow)
+			setnz_b(r.b = (Byte) value);
+		else
+			setnz_w(r.w = (Word) value);
+		return (true);
+	}
+
 	// Push a byte on the stack
 	INLINE static void pushByte(Byte value)
 	{
@@ -108,13 +419,48 @@ private:
 			--sp.w;
 	}
 
-	// Push a word on the stack
+	// Push a word on the stack. When both bytes lie in the same RAM page they
+	// are written through a single host pointer.
 	INLINE static void pushWord(Word value)
 	{
+		register Byte  *pSpan;
+
+		if ((pSpan = setSpan(sp.w - 1, 2))) {
+			pSpan[0] = lo(value);
+			pSpan[1] = hi(value);
+
+			if (e)
+				sp.b -= 2;
+			else
+				sp.w -= 2;
+			return;
+		}
+
 		pushByte(hi(value));
 		pushByte(lo(value));
 	}
 
+	// Push a bank and word on the stack
+	INLINE static void pushLong(Addr value)
+	{
+		register Byte  *pSpan;
+
+		if ((pSpan = setSpan(sp.w - 2, 3))) {
+			pSpan[0] = lo(value);
+			pSpan[1] = hi(value);
+			pSpan[2] = lo(value >> 16);
+
+			if (e)
+				sp.b -= 3;
+			else
+				sp.w -= 3;
+			return;
+		}
+
+		pushByte(lo(value >> 16));
+		pushWord((Word) value);
+	}
+
 	// Pull a byte from the stack
 	INLINE static Byte pullByte()
 	{
@@ -129,16 +475,46 @@ private:
 	// Pull a word from the stack
 	INLINE static Word pullWord()
 	{
+		register const Byte *pSpan;
+
+		if (sp.b != 0xff && (pSpan = getSpan(sp.w + 1, 2))) {
+			if (e)
+				sp.b += 2;
+			else
+				sp.w += 2;
+
+			return (join(pSpan[0], pSpan[1]));
+		}
+
 		register Byte	l = pullByte();
 		register Byte	h = pullByte();
 
 		return (join(l, h));
 	}
 
+	// Pull a word and bank from the stack
+	INLINE static Addr pullLong()
+	{
+		register const Byte *pSpan;
+
+		if (sp.b != 0xff && (pSpan = getSpan(sp.w + 1, 3))) {
+			if (e)
+				sp.b += 3;
+			else
+				sp.w += 3;
+
+			return (join(pSpan[2], join(pSpan[0], pSpan[1])));
+		}
+
+		register Word	w = pullWord();
+
+		return (join(pullByte(), w));
+	}
+
 	// Absolute - a
 	INLINE static Addr am_absl()
 	{
-		register Addr	ea = join (dbr, getWord(bank(pbr) | pc));
+		register Addr	ea = join (dbr, getCodeWord(bank(pbr) | pc));
 
 		BYTES(2);
 		cycles += 2;
@@ -148,7 +524,7 @@ private:
 	// Absolute Indexed X - a,X
 	INLINE static Addr am_absx()
 	{
-		register Addr	ea = join(dbr, getWord(bank(pbr) | pc)) + x.w;
+		register Addr	ea = join(dbr, getCodeWord(bank(pbr) | pc)) + x.w;
 
 		BYTES(2);
 		cycles += 2;
@@ -158,7 +534,7 @@ private:
 	// Absolute Indexed Y - a,Y
 	INLINE static Addr am_absy()
 	{
-		register Addr	ea = join(dbr, getWord(bank(pbr) | pc)) + y.w;
+		register Addr	ea = join(dbr, getCodeWord(bank(pbr) | pc)) + y.w;
 
 		BYTES(2);
 		cycles += 2;
@@ -168,7 +544,7 @@ private:
 	// Absolute Indirect - (a)
 	INLINE static Addr am_absi()
 	{
-		register Addr ia = join(0, getWord(bank(pbr) | pc));
+		register Addr ia = join(0, getCodeWord(bank(pbr) | pc));
 
 		BYTES(2);
 		cycles += 4;
@@ -178,7 +554,7 @@ private:
 	// Absolute Indexed Indirect - (a,X)
 	INLINE static Addr am_abxi()
 	{
-		register Addr ia = join(pbr, getWord(join(pbr, pc))) + x.w;
+		register Addr ia = join(pbr, getCodeWord(join(pbr, pc))) + x.w;
 
 		BYTES(2);
 		cycles += 4;
@@ -188,7 +564,7 @@ private:
 	// Absolute Long - >a
 	INLINE static Addr am_alng()
 	{
-		Addr ea = getAddr(join(pbr, pc));
+		Addr ea = getCodeAddr(join(pbr, pc));
 
 		BYTES(3);
 		cycles += 3;
@@ -198,7 +574,7 @@ private:
 	// Absolute Long Indexed - >a,X
 	INLINE static Addr am_alnx()
 	{
-		register Addr ea = getAddr(join(pbr, pc)) + x.w;
+		register Addr ea = getCodeAddr(join(pbr, pc)) + x.w;
 
 		BYTES(3);
 		cycles += 3;
@@ -208,7 +584,7 @@ private:
 	// Absolute Indirect Long - [a]
 	INLINE static Addr am_abil()
 	{
-		register Addr ia = bank(0) | getWord(join(pbr, pc));
+		register Addr ia = bank(0) | getCodeWord(join(pbr, pc));
 
 		BYTES(2);
 		cycles += 5;
@@ -218,7 +594,7 @@ private:
 	// Direct Page - d
 	INLINE static Addr am_dpag()
 	{
-		Byte offset = getByte(bank(pbr) | pc);
+		Byte offset = getCodeByte(bank(pbr) | pc);
 
 		BYTES(1);
 		cycles += 1;
@@ -228,7 +604,7 @@ private:
 	// Direct Page Indexed X - d,X
 	INLINE static Addr am_dpgx()
 	{
-		Byte offset = getByte(bank(pbr) | pc) + x.b;
+		Byte offset = getCodeByte(bank(pbr) | pc) + x.b;
 
 		BYTES(1);
 		cycles += 1;
@@ -238,7 +614,7 @@ private:
 	// Direct Page Indexed Y - d,Y
 	INLINE static Addr am_dpgy()
 	{
-		Byte offset = getByte(bank(pbr) | pc) + y.b;
+		Byte offset = getCodeByte(bank(pbr) | pc) + y.b;
 
 		BYTES(1);
 		cycles += 1;
@@ -248,7 +624,7 @@ private:
 	// Direct Page Indirect - (d)
 	INLINE static Addr am_dpgi()
 	{
-		Byte disp = getByte(bank(pbr) | pc);
+		Byte disp = getCodeByte(bank(pbr) | pc);
 
 		BYTES(1);
 		cycles += 3;
@@ -258,7 +634,7 @@ private:
 	// Direct Page Indexed Indirect - (d,x)
 	INLINE static Addr am_dpix()
 	{
-		Byte disp = getByte(join(pbr, pc));
+		Byte disp = getCodeByte(join(pbr, pc));
 
 		BYTES(1);
 		cycles += 3;
@@ -268,7 +644,7 @@ private:
 	// Direct Page Indirect Indexed - (d),Y
 	INLINE static Addr am_dpiy()
 	{
-		Byte disp = getByte(join(pbr, pc));
+		Byte disp = getCodeByte(join(pbr, pc));
 
 		BYTES(1);
 		cycles += 3;
@@ -278,7 +654,7 @@ private:
 	// Direct Page Indirect Long - [d]
 	INLINE static Addr am_dpil()
 	{
-		Byte disp = getByte(join(pbr, pc));
+		Byte disp = getCodeByte(join(pbr, pc));
 
 		BYTES(1);
 		cycles += 4;
@@ -288,7 +664,7 @@ private:
 	// Direct Page Indirect Long Indexed - [d],Y
 	INLINE static Addr am_dily()
 	{
-		Byte disp = getByte(join(pbr, pc));
+		Byte disp = getCodeByte(join(pbr, pc));
 
 		BYTES(1);
 		cycles += 4;
@@ -354,7 +730,7 @@ private:
 	// Long Relative - d
 	INLINE static Addr am_lrel()
 	{
-		Word disp = getWord(join(pbr, pc));
+		Word disp = getCodeWord(join(pbr, pc));
 
 		BYTES(2);
 		cycles += 2;
@@ -364,7 +740,7 @@ private:
 	// Relative - d
 	INLINE static Addr am_rela()
 	{
-		Byte disp = getByte(join(pbr, pc));
+		Byte disp = getCodeByte(join(pbr, pc));
 
 		BYTES(1);
 		cycles += 1;
@@ -374,7 +750,7 @@ private:
 	// Stack Relative - d,S
 	INLINE static Addr am_srel()
 	{
-		Byte disp = getByte(join(pbr, pc));
+		Byte disp = getCodeByte(join(pbr, pc));
 
 		BYTES(1);
 		cycles += 1;
@@ -388,7 +764,7 @@ private:
 	// Stack Relative Indirect Indexed Y - (d,S),Y
 	INLINE static Addr am_sriy()
 	{
-		Byte disp = getByte(join(pbr, pc));
+		Byte disp = getCodeByte(join(pbr, pc));
 		register Word ia;
 
 		BYTES(1);
@@ -460,10 +836,7 @@ private:
 			Byte	data = getByte(ea);
 			Word	temp = a.b + data + p.f_c;
 			
-			if (p.f_d) {
-				if ((temp & 0x0f) > 0x09) temp += 0x06;
-				if ((temp & 0xf0) > 0x90) temp += 0x60;
-			}
+			if (p.f_d) temp += bcdAdjust[temp & 0xff];
 
 			setc(temp & 0x100);
 			setv((~(a.b ^ data)) & (a.b ^ temp) & 0x80);
@@ -475,10 +848,8 @@ private:
 			int		temp = a.w + data + p.f_c;
 
 			if (p.f_d) {
-				if ((temp & 0x000f) > 0x0009) temp += 0x0006;
-				if ((temp & 0x00f0) > 0x0090) temp += 0x0060;
-				if ((temp & 0x0f00) > 0x0900) temp += 0x0600;
-				if ((temp & 0xf000) > 0x9000) temp += 0x6000;
+				temp += bcdAdjust[temp & 0xff];
+				temp += bcdAdjust[(temp >> 8) & 0xff] << 8;
 			}
 			
 			setc(temp & 0x10000);
@@ -548,10 +919,13 @@ private:
 		if (p.f_c == 0) {
 			if (e && ((pc ^ ea) & 0xff00)) ++cycles;
 			pc = (Word)ea;
+			edge();
 			cycles += 3;
 		}
-		else
+		else {
+			edge();
 			cycles += 2;
+		}
 	}
 
 	INLINE static void op_bcs(Addr ea)
@@ -561,10 +935,13 @@ private:
 		if (p.f_c == 1) {
 			if (e && ((pc ^ ea) & 0xff00)) ++cycles;
 			pc = (Word)ea;
+			edge();
 			cycles += 3;
 		}
-		else
+		else {
+			edge();
 			cycles += 2;
+		}
 	}
 
 	INLINE static void op_beq(Addr ea)
@@ -574,10 +951,13 @@ private:
 		if (p.f_z == 1) {
 			if (e && ((pc ^ ea) & 0xff00)) ++cycles;
 			pc = (Word)ea;
+			edge();
 			cycles += 3;
 		}
-		else
+		else {
+			edge();
 			cycles += 2;
+		}
 	}
 
 	INLINE static void op_bit(Addr ea)
@@ -627,10 +1007,13 @@ private:
 		if (p.f_n == 1) {
 			if (e && ((pc ^ ea) & 0xff00)) ++cycles;
 			pc = (Word)ea;
+			edge();
 			cycles += 3;
 		}
-		else
+		else {
+			edge();
 			cycles += 2;
+		}
 	}
 
 	INLINE static void op_bne(Addr ea)
@@ -640,10 +1023,13 @@ private:
 		if (p.f_z == 0) {
 			if (e && ((pc ^ ea) & 0xff00)) ++cycles;
 			pc = (Word)ea;
+			edge();
 			cycles += 3;
 		}
-		else
+		else {
+			edge();
 			cycles += 2;
+		}
 	}
 
 	INLINE static void op_bpl(Addr ea)
@@ -653,10 +1039,13 @@ private:
 		if (p.f_n == 0) {
 			if (e && ((pc ^ ea) & 0xff00)) ++cycles;
 			pc = (Word)ea;
+			edge();
 			cycles += 3;
 		}
-		else
+		else {
+			edge();
 			cycles += 2;
+		}
 	}
 
 	INLINE static void op_bra(Addr ea)
@@ -665,6 +1054,7 @@ private:
 
 		if (e && ((pc ^ ea) & 0xff00)) ++cycles;
 		pc = (Word)ea;
+		edge();
 		cycles += 3;
 	}
 
@@ -672,6 +1062,7 @@ private:
 	{
 		TRACE("BRK");
 
+		++interrupts;
 		if (e) {
 			pushWord(pc);
 			pushByte(p.b | 0x10);
@@ -684,8 +1075,7 @@ private:
 			cycles += 7;
 		}
 		else {
-			pushByte(pbr);
-			pushWord(pc);
+			pushLong(join(pbr, pc));
 			pushByte(p.b);
 
 			p.f_i = 1;
@@ -702,6 +1092,7 @@ private:
 		TRACE("BRL");
 
 		pc = (Word)ea;
+		edge();
 		cycles += 3;
 	}
 
@@ -712,10 +1103,13 @@ private:
 		if (p.f_v == 0) {
 			if (e && ((pc ^ ea) & 0xff00)) ++cycles;
 			pc = (Word)ea;
+			edge();
 			cycles += 3;
 		}
-		else
+		else {
+			edge();
 			cycles += 2;
+		}
 	}
 
 	INLINE static void op_bvs(Addr ea)
@@ -725,10 +1119,13 @@ private:
 		if (p.f_v == 1) {
 			if (e && ((pc ^ ea) & 0xff00)) ++cycles;
 			pc = (Word)ea;
+			edge();
 			cycles += 3;
 		}
-		else
+		else {
+			edge();
 			cycles += 2;
+		}
 	}
 
 	INLINE static void op_clc(Addr ea)
@@ -789,6 +1186,7 @@ private:
 	{
 		TRACE("COP");
 
+		++interrupts;
 		if (e) {
 			pushWord(pc);
 			pushByte(p.b);
@@ -801,8 +1199,7 @@ private:
 			cycles += 7;
 		}
 		else {
-			pushByte(pbr);
-			pushWord(pc);
+			pushLong(join(pbr, pc));
 			pushByte(p.b);
 
 			p.f_i = 1;
@@ -990,6 +1387,7 @@ private:
 
 		pbr = lo(ea >> 16);
 		pc = (Word)ea;
+		edge();
 		cycles += 1;
 	}
 
@@ -997,11 +1395,11 @@ private:
 	{
 		TRACE("JSL");
 
-		pushByte(pbr);
-		pushWord(pc - 1);
+		pushLong(join(pbr, (Word)(pc - 1)));
 
 		pbr = lo(ea >> 16);
 		pc = (Word)ea;
+		edge();
 		cycles += 5;
 	}
 
@@ -1012,6 +1410,7 @@ private:
 		pushWord(pc - 1);
 
 		pc = (Word)ea;
+		edge();
 		cycles += 4;
 	}
 
@@ -1326,8 +1725,11 @@ private:
 	{
 		TRACE("REP");
 
+		register Byte	old = p.b;
+
 		p.b &= ~getByte(ea);
 		if (e) p.f_m = p.f_x = 1;
+		if ((old ^ p.b) & 0x30) ++modeSwitches;
 		cycles += 3;
 	}
 
@@ -1427,20 +1829,27 @@ private:
 			cycles += 6;
 		}
 		else {
+			register Addr	ret;
+
 			p.b = pullByte();
-			pc = pullWord();
-			pbr = pullByte();
+			ret = pullLong();
+			pc = (Word) ret;
+			pbr = lo(ret >> 16);
 			cycles += 7;
 		}
 		p.f_i = 0;
+		edge();
 	}
 
 	INLINE static void op_rtl(Addr ea)
 	{
 		TRACE("RTL");
 
-		pc = pullWord() + 1;
-		pbr = pullByte();
+		register Addr	ret = pullLong();
+
+		pc = (Word) ret + 1;
+		pbr = lo(ret >> 16);
+		edge();
 		cycles += 6;
 	}
 
@@ -1449,6 +1858,7 @@ private:
 		TRACE("RTS");
 
 		pc = pullWord() + 1;
+		edge();
 		cycles += 6;
 	}
 
@@ -1460,10 +1870,7 @@ private:
 			Byte	data = ~getByte(ea);
 			Word	temp = a.b + data + p.f_c;
 			
-			if (p.f_d) {
-				if ((temp & 0x0f) > 0x09) temp += 0x06;
-				if ((temp & 0xf0) > 0x90) temp += 0x60;
-			}
+			if (p.f_d) temp += bcdAdjust[temp & 0xff];
 
 			setc(temp & 0x100);
 			setv((~(a.b ^ data)) & (a.b ^ temp) & 0x80);
@@ -1475,10 +1882,8 @@ private:
 			int		temp = a.w + data + p.f_c;
 
 			if (p.f_d) {
-				if ((temp & 0x000f) > 0x0009) temp += 0x0006;
-				if ((temp & 0x00f0) > 0x0090) temp += 0x0060;
-				if ((temp & 0x0f00) > 0x0900) temp += 0x0600;
-				if ((temp & 0xf000) > 0x9000) temp += 0x6000;
+				temp += bcdAdjust[temp & 0xff];
+				temp += bcdAdjust[(temp >> 8) & 0xff] << 8;
 			}
 
 			setc(temp & 0x10000);
@@ -1516,8 +1921,11 @@ private:
 	{
 		TRACE("SEP");
 
+		register Byte	old = p.b;
+
 		p.b |= getByte(ea);
 		if (e) p.f_m = p.f_x = 1;
+		if ((old ^ p.b) & 0x30) ++modeSwitches;
 
 		if (p.f_x) {
 			x.w = x.b;
@@ -1546,6 +1954,7 @@ private:
 
 		if (!interrupted) {
 			pc -= 1;
+			waiting = true;
 		}
 		else
 			interrupted = false;
@@ -1777,6 +2186,7 @@ private:
 
 		if (!interrupted) {
 			pc -= 1;
+			waiting = true;
 		}
 		else
 			interrupted = false;
@@ -1786,11 +2196,36 @@ private:
 
 	INLINE static void op_wdm(Addr ea)
 	{
+		// A trap fetched from a breakpoint stops before the instruction
+		if (isTrap(ea - 1)) {
+			pc -= 2;
+			--instructions;
+			breakAt = join(pbr, pc);
+			stopped = true;
+			return;
+		}
+
 		TRACE("WDM");
 
 		switch (getByte(ea)) {
-		case 0x01:	cout << (char) a.b; break;
-		case 0x02:  cin >> a.b; break;
+		case 0x01:	*pOut << (char) a.b; break;
+		case 0x02:
+#ifndef CHIPKIT
+			if (pJournal) {
+				pJournal->read(*pIn, cycles, a.b);
+				break;
+			}
+#endif
+			*pIn >> a.b;
+			break;
+#ifndef CHIPKIT
+		case 0x10:	if (pRegions) pRegions->start(join(dbr, x.w), cycles); break;
+		case 0x11:	if (pRegions) pRegions->stop(join(dbr, x.w), cycles); break;
+#endif
+		// Copy the cycle counter, then read the 16 bits of the copy that the
+		// low two bits of X select into A
+		case 0x12:	latched = cycles; // Fall through
+		case 0x13:	a.w = (Word)(latched >> (16 * (x.b & 3))); break;
 		case 0xff:	stopped = true;  break;
 		}
 		cycles += 3;
@@ -1813,6 +2248,7 @@ private:
 
 		e = p.f_c;
 		p.f_c = oe;
+		if (e != oe) ++modeSwitches;
 
 		if (e) {
 			p.b |= 0x30;
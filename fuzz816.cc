@@ -0,0 +1,382 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include <string.h>
+
+#include "fuzz816.h"
+#include "load816.h"
+
+// Hit counts are reduced to buckets so that loops only count as new coverage
+// when their trip count changes in magnitude.
+static wdc816::Byte buckets[256];
+
+// Byte values that often trigger edge cases
+static const wdc816::Byte special[] = {
+	0x00, 0x01, 0x0a, 0x0d, 0x20, 0x30, 0x39, 0x41,
+	0x5a, 0x7f, 0x80, 0x81, 0xfe, 0xff
+};
+
+// The largest input fed to WDM #$02
+#define	MAX_STREAM	4096
+
+//==============================================================================
+
+// Create a fuzzer for guests with the given memory configuration
+fuzz816::fuzz816(Addr memMask, Addr ramSize, unsigned long limit)
+	: memMask(memMask), ramSize(ramSize), limit(limit),
+	  bufferAddr(0), bufferSize(0), entry(0), hasEntry(false),
+	  ram(ramSize), dirty((ramSize + 255) >> 8), pages((ramSize + 255) >> 8),
+	  coverage(emu816::COVERAGE_SIZE), virgin(emu816::COVERAGE_SIZE, 0xff),
+	  seed(2463534242UL)
+{
+	memset(&stats, 0, sizeof(stats));
+
+	if (!buckets[1]) {
+		for (unsigned int count = 1; count < 256; ++count)
+			buckets[count] =
+				(count < 4) ? (Byte)(1 << (count - 1)) :
+				(count < 8) ? 0x08 :
+				(count < 16) ? 0x10 :
+				(count < 32) ? 0x20 :
+				(count < 128) ? 0x40 : 0x80;
+	}
+	in.unsetf(ios::skipws);
+}
+
+// Detach the emulator from the fuzzer
+fuzz816::~fuzz816()
+{
+	emu816::setCoverage(NULL);
+	emu816::setDirtyLog(NULL, NULL);
+	emu816::setConsole(&cin, &cout);
+}
+
+// Inject inputs into RAM
+void fuzz816::setBuffer(Addr addr, Addr size)
+{
+	bufferAddr = addr;
+	bufferSize = size;
+}
+
+// Set an explicit snapshot address
+void fuzz816::setEntry(Addr addr)
+{
+	entry = addr;
+	hasEntry = true;
+}
+
+//==============================================================================
+// Snapshot and Seeds
+//------------------------------------------------------------------------------
+
+// Load and boot the guest, stopping just before the instruction at the entry
+// address or the first WDM #$02.
+bool fuzz816::boot(const vector<string> &images)
+{
+	emu816::setMemory(memMask, ramSize, ram.data(), NULL);
+	for (size_t index = 0; index < images.size(); ++index)
+		if (!load816::load(images[index].c_str())) return (false);
+
+	emu816::setConsole(&in, &out);
+	emu816::reset(false);
+
+	// Step single instructions so the entry point cannot be fused over
+	bool	fused = emu816::isFusing();
+
+	emu816::setFusion(false);
+	for (;;) {
+		emu816::save(cpu);
+
+		Addr	ea = join(cpu.pbr, cpu.pc);
+
+		if (hasEntry) {
+			if (ea == entry) break;
+		}
+		else {
+			if ((emu816::getByte(ea) == 0x42) &&
+				(emu816::getByte(join(cpu.pbr, (Word)(cpu.pc + 1))) == 0x02))
+				break;
+		}
+		if (cpu.stopped || cpu.waiting || (cpu.cycles >= limit)) {
+			emu816::setFusion(fused);
+			return (false);
+		}
+
+		emu816::step();
+	}
+	emu816::setFusion(fused);
+
+	image.assign(ram.begin(), ram.end());
+	emu816::setDirtyLog(dirty.data(), pages.data());
+	emu816::setCoverage(coverage.data());
+	return (true);
+}
+
+// Read a seed file, or each file in a seed directory
+bool fuzz816::addSeeds(const char *path)
+{
+	error_code					error;
+	vector<filesystem::path>	files;
+
+	if (filesystem::is_directory(path, error)) {
+		for (filesystem::directory_iterator item(path, error);
+				item != filesystem::directory_iterator(); item.increment(error))
+			if (item->is_regular_file(error)) files.push_back(item->path());
+		sort(files.begin(), files.end());
+	}
+	else
+		files.push_back(path);
+
+	for (size_t index = 0; index < files.size(); ++index) {
+		ifstream	file(files[index], ios::binary);
+		Input		input;
+
+		if (!file.is_open()) return (false);
+
+		input.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+		if (input.size() > (bufferSize ? bufferSize : MAX_STREAM))
+			input.resize(bufferSize ? bufferSize : MAX_STREAM);
+		queue.push_back(input);
+	}
+	return (true);
+}
+
+//==============================================================================
+// Execution
+//------------------------------------------------------------------------------
+
+// Run one input from the snapshot, returning true if it hit the cycle limit.
+bool fuzz816::exec(const Input &input)
+{
+	// Roll back only the RAM pages the last run wrote to
+	for (Addr index = 0; index < emu816::getDirtyCount(); ++index) {
+		Addr	base = pages[index] << 8;
+
+		memcpy(&ram[base], &image[base], min((Addr) 256, ramSize - base));
+	}
+	emu816::clearDirty();
+	emu816::restore(cpu);
+
+	if (bufferSize) {
+		for (Addr index = 0; index < bufferSize; ++index)
+			emu816::setByte(bufferAddr + index,
+				(index < input.size()) ? input[index] : 0);
+	}
+	else {
+		in.clear();
+		in.str(string(input.begin(), input.end()));
+	}
+	out.str("");
+
+	memset(coverage.data(), 0, coverage.size());
+	emu816::setCoverage(coverage.data());
+	emu816::run(limit);
+
+	// A processor parked in WAI or STP is left on the instruction
+	++stats.execs;
+	if (emu816::isStopped())
+		++stats.exits;
+	else if (emu816::isWaiting() && (emu816::peekByte(emu816::getPC()) == 0xdb))
+		++stats.stops;
+	return (!emu816::isStopped() && !emu816::isWaiting());
+}
+
+// Fold the last run's coverage into the seen buckets, returning true if any
+// edge was hit a new number of times.
+bool fuzz816::interesting()
+{
+	const unsigned long long   *words = (const unsigned long long *) coverage.data();
+	bool						found = false;
+
+	for (size_t word = 0; word < coverage.size() / 8; ++word) {
+		if (!words[word]) continue;
+
+		for (size_t index = word * 8; index < word * 8 + 8; ++index) {
+			Byte	bucket = buckets[coverage[index]];
+
+			if (bucket & virgin[index]) {
+				if (virgin[index] == 0xff) ++stats.edges;
+				virgin[index] &= ~bucket;
+				found = true;
+			}
+		}
+	}
+	return (found);
+}
+
+//==============================================================================
+// Mutation
+//------------------------------------------------------------------------------
+
+// Return a pseudo random number below range
+unsigned long fuzz816::random(unsigned long range)
+{
+	seed ^= (seed << 13) & 0xffffffffUL;
+	seed ^= seed >> 17;
+	seed ^= (seed << 5) & 0xffffffffUL;
+	return (seed % range);
+}
+
+// Apply a random stack of byte level mutations to an input
+void fuzz816::mutate(Input &input)
+{
+	size_t	maxSize = bufferSize ? bufferSize : MAX_STREAM;
+
+	for (unsigned int count = 1 << random(4); count > 0; --count) {
+		size_t	size = input.size();
+
+		switch (size ? random(8) : 4) {
+		case 0:		// Flip a bit
+			input[random(size)] ^= 1 << random(8);
+			break;
+
+		case 1:		// Set a random byte
+			input[random(size)] = (Byte) random(256);
+			break;
+
+		case 2:		// Set a special byte
+			input[random(size)] = special[random(sizeof(special))];
+			break;
+
+		case 3:		// Add or subtract a small amount
+			input[random(size)] += (Byte)(random(35) - 17);
+			break;
+
+		case 4:		// Insert a random byte
+			if (size < maxSize)
+				input.insert(input.begin() + random(size + 1), (Byte) random(256));
+			break;
+
+		case 5:		// Delete a byte
+			input.erase(input.begin() + random(size));
+			break;
+
+		case 6:		// Copy a block within the input
+			{
+				size_t	from = random(size);
+				size_t	to = random(size);
+				size_t	len = 1 + random(min(size - max(from, to), (size_t) 16));
+
+				memmove(&input[to], &input[from], len);
+			}
+			break;
+
+		case 7:		// Splice in part of another input
+			{
+				const Input &other = queue[random(queue.size())];
+
+				if (!other.empty()) {
+					size_t	from = random(other.size());
+					size_t	len = min(other.size() - from, maxSize - size);
+
+					len = random(len + 1);
+					input.insert(input.begin() + random(size + 1),
+						other.begin() + from, other.begin() + from + len);
+				}
+			}
+			break;
+		}
+	}
+}
+
+// Write an input to a file
+bool fuzz816::save(const string &filename, const Input &input)
+{
+	ofstream	file(filename.c_str(), ios::binary);
+
+	if (!file.is_open()) return (false);
+
+	file.write((const char *) input.data(), input.size());
+	return (file.good());
+}
+
+//==============================================================================
+// Fuzzing Loop
+//------------------------------------------------------------------------------
+
+// Run the seeds then fuzz mutated inputs, reporting progress once a second.
+bool fuzz816::fuzz(unsigned long execs, const char *dir)
+{
+	typedef chrono::steady_clock Clock;
+
+	error_code		error;
+	string			queueDir = string(dir) + "/queue";
+	string			hangsDir = string(dir) + "/hangs";
+
+	filesystem::create_directories(queueDir, error);
+	filesystem::create_directories(hangsDir, error);
+	if (error) return (false);
+
+	if (queue.empty())
+		queue.push_back(Input());
+
+	Clock::time_point	start = Clock::now();
+	Clock::time_point	report = start;
+
+	// Every seed is kept and primes the coverage map
+	for (size_t index = 0; index < queue.size(); ++index) {
+		if (exec(queue[index])) ++stats.hangs;
+		interesting();
+	}
+
+	while (!execs || (stats.execs < execs)) {
+		Input	input = queue[random(queue.size())];
+
+		mutate(input);
+
+		bool	hung = exec(input);
+
+		if (hung) ++stats.hangs;
+		if (interesting()) {
+			ostringstream	name;
+
+			name << (hung ? hangsDir : queueDir) << "/id_" << setw(6)
+				<< setfill('0') << (hung ? stats.hangs : ++stats.paths);
+			if (!save(name.str(), input)) return (false);
+			if (!hung) queue.push_back(input);
+		}
+
+		if (!(stats.execs & 1023) && (Clock::now() - report >= chrono::seconds(1))) {
+			report = Clock::now();
+			stats.secs = chrono::duration<double>(report - start).count();
+			cerr << "\r" << stats.execs << " execs, "
+				<< (unsigned long)(stats.execs / stats.secs) << "/sec, "
+				<< stats.paths << " paths, " << stats.edges << " edges, "
+				<< stats.hangs << " hangs   " << flush;
+		}
+	}
+
+	stats.secs = chrono::duration<double>(Clock::now() - start).count();
+	cerr << endl;
+	return (true);
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef FUZZ816_H
+#define FUZZ816_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "emu816.h"
+
+// The fuzz816 class drives coverage-guided fuzzing of guest code. The guest is
+// booted once up to its first read of input and snapshotted. Each test input
+// is then placed in a RAM buffer or fed to WDM #$02 and run from the snapshot
+// under a cycle limit, recording the branches and jumps taken in an edge
+// bitmap. Inputs that reach new edges are kept and mutated further. Between
+// runs only the pages of RAM that were written are restored.
+
+class fuzz816 :
+	public wdc816
+{
+public:
+	// The fuzzing statistics
+	struct Stats {
+		unsigned long	execs;			// Inputs run
+		unsigned long	paths;			// Inputs kept for new coverage
+		unsigned long	hangs;			// Inputs that hit the cycle limit
+		unsigned long	exits;			// Inputs that ended with WDM #$FF
+		unsigned long	stops;			// Inputs that ran to a STP
+		unsigned long	edges;			// Edges seen so far
+		double			secs;			// Wall time spent fuzzing
+	};
+
+	fuzz816(Addr memMask, Addr ramSize, unsigned long limit);
+	~fuzz816();
+
+	// Place each input in RAM at addr rather than feeding it to WDM #$02
+	void setBuffer(Addr addr, Addr size);
+
+	// Snapshot when execution reaches the given address rather than at the
+	// first WDM #$02
+	void setEntry(Addr addr);
+
+	// Load the images and run the guest up to the snapshot point
+	bool boot(const std::vector<std::string> &images);
+
+	// Add a seed input, or every file in a seed directory
+	bool addSeeds(const char *path);
+
+	// Fuzz for the given number of executions (zero for no limit), saving the
+	// interesting inputs and hangs below dir
+	bool fuzz(unsigned long execs, const char *dir);
+
+	// Retrieve the statistics
+	INLINE const Stats &getStats() const
+	{
+		return (stats);
+	}
+
+private:
+	typedef std::vector<Byte> Input;
+
+	Addr				memMask;
+	Addr				ramSize;
+	unsigned long		limit;
+	Addr				bufferAddr;
+	Addr				bufferSize;		// Zero to use WDM #$02
+	Addr				entry;
+	bool				hasEntry;
+
+	emu816::State		cpu;			// Snapshot of the booted guest
+	std::vector<Byte>	image;			// ... and its RAM
+	emu816::RAM			ram;
+	std::vector<Byte>	dirty;			// Per page written flags
+	std::vector<Addr>	pages;			// ... and the pages written
+
+	std::vector<Byte>	coverage;		// Edge hits of the last run
+	std::vector<Byte>	virgin;			// Edge hit buckets not yet seen
+	std::vector<Input>	queue;			// Inputs with new coverage
+	std::istringstream	in;
+	std::ostringstream	out;
+
+	unsigned long		seed;			// Mutation generator state
+	Stats				stats;
+
+	bool exec(const Input &input);
+	bool interesting();
+	void mutate(Input &input);
+	unsigned long random(unsigned long range);
+	static bool save(const std::string &filename, const Input &input);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,555 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+# include <netinet/in.h>
+# include <netinet/tcp.h>
+# include <poll.h>
+# include <string.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL	0
+#endif
+
+#include "gdb816.h"
+#include "emu816.h"
+
+// The largest packet the client may send
+#define PACKET_SIZE	4096
+
+// The request for the target description
+#define XFER_TARGET	"qXfer:features:read:target.xml"
+
+// How long to sleep on the socket while the guest waits for an interrupt
+#define IDLE_MS		10
+
+// Register sizes in bytes, in the order of a 'g' packet
+static const unsigned int sizes[] = { 2, 2, 2, 2, 2, 4, 1, 1, 1 };
+
+enum { REG_A, REG_X, REG_Y, REG_SP, REG_DP, REG_PC, REG_DBR, REG_P, REG_E, REGS };
+
+// The register layout offered to clients asking for a target description
+static const char targetXML[] =
+	"<?xml version=\"1.0\"?>\n"
+	"<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+	"<target version=\"1.0\">\n"
+	"<feature name=\"org.emu816.cpu\">\n"
+	"<reg name=\"a\" bitsize=\"16\" type=\"int\"/>\n"
+	"<reg name=\"x\" bitsize=\"16\" type=\"int\"/>\n"
+	"<reg name=\"y\" bitsize=\"16\" type=\"int\"/>\n"
+	"<reg name=\"sp\" bitsize=\"16\" type=\"data_ptr\"/>\n"
+	"<reg name=\"dp\" bitsize=\"16\" type=\"data_ptr\"/>\n"
+	"<reg name=\"pc\" bitsize=\"32\" type=\"code_ptr\"/>\n"
+	"<reg name=\"dbr\" bitsize=\"8\" type=\"int\"/>\n"
+	"<reg name=\"p\" bitsize=\"8\" type=\"int\"/>\n"
+	"<reg name=\"e\" bitsize=\"8\" type=\"int\"/>\n"
+	"</feature>\n"
+	"</target>\n";
+
+THREAD_LOCAL wdc816::Addr		gdb816::watchAddr;
+THREAD_LOCAL bool				gdb816::watchWrite;
+
+// Format a value as little endian hex pairs
+static string toLittle(unsigned long value, unsigned int bytes)
+{
+	static const char	digits[] = "0123456789abcdef";
+	string				hex;
+
+	while (bytes--) {
+		hex += digits[(value >> 4) & 0xf];
+		hex += digits[value & 0xf];
+		value >>= 8;
+	}
+	return (hex);
+}
+
+// Parse little endian hex pairs into a value
+static unsigned long fromLittle(const string &hex, unsigned int bytes)
+{
+	unsigned long	value = 0;
+
+	for (unsigned int index = 0; (index < bytes) && (2 * index + 1 < hex.size()); ++index)
+		value |= strtoul(hex.substr(2 * index, 2).c_str(), NULL, 16) << (8 * index);
+	return (value);
+}
+
+//==============================================================================
+
+// Construct an idle stub
+gdb816::gdb816(const char *target, unsigned long quantum)
+	: target(target), quantum(quantum), listener(-1), client(-1),
+	  acking(true)
+{ }
+
+// Close any connection and remove any socket
+gdb816::~gdb816()
+{
+	emu816::setBreakpoints(NULL);
+	emu816::setWatches(NULL, NULL);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (client >= 0) close(client);
+	if (listener >= 0) {
+		close(listener);
+		if (target.compare(0, 5, "unix:") == 0)
+			unlink(target.substr(5).c_str());
+	}
+#endif
+}
+
+// Listen on the target and wait for a client. A TCP port is bound to the
+// loopback interface only as the protocol has no authentication.
+bool gdb816::open()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (target.compare(0, 5, "unix:") == 0) {
+		sockaddr_un		addr;
+		string			path = target.substr(5);
+
+		if (path.size() >= sizeof(addr.sun_path)) return (false);
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, path.c_str());
+		unlink(path.c_str());
+
+		if ((listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return (false);
+		if (bind(listener, (sockaddr *) &addr, sizeof(addr)) != 0) return (false);
+	}
+	else {
+		sockaddr_in		addr;
+		int				on = 1;
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons((unsigned short) strtoul(target.c_str(), NULL, 10));
+
+		if ((listener = socket(AF_INET, SOCK_STREAM, 0)) < 0) return (false);
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+		if (bind(listener, (sockaddr *) &addr, sizeof(addr)) != 0) return (false);
+	}
+
+	if ((listen(listener, 1) != 0) || ((client = accept(listener, NULL, NULL)) < 0))
+		return (false);
+
+	int		on = 1;
+
+	if (target.compare(0, 5, "unix:") != 0)
+		setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+	// Single steps and watch hits must each stop at one instruction, and
+	// only the client's breakpoints and watchpoints apply
+	emu816::setFusion(false);
+	emu816::setBreakpoints(NULL);
+	emu816::setWatches(NULL, NULL);
+	return (true);
+#else
+	return (false);
+#endif
+}
+
+// Handle packets until the session ends
+bool gdb816::serve()
+{
+	string	packet;
+	bool	done = false;
+	bool	detach = false;
+
+	while (!done && receive(packet)) {
+		string	reply = handle(packet, done, detach);
+
+		if ((packet != "k") && !send(reply)) break;
+		if (packet == "QStartNoAckMode") acking = false;
+		if (reply[0] == 'W') break;
+	}
+
+	emu816::setBreakpoints(NULL);
+	emu816::setWatches(NULL, NULL);
+	emu816::resume();
+	return (detach);
+}
+
+//==============================================================================
+// Packets
+//------------------------------------------------------------------------------
+
+// Read the next packet from the client, acknowledging it if required. Stray
+// acknowledgements and interrupts are discarded.
+bool gdb816::receive(string &packet)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	for (;;) {
+		size_t	start = input.find('$');
+
+		if (start != string::npos) {
+			size_t	end = input.find('#', start);
+
+			if ((end != string::npos) && (end + 2 < input.size())) {
+				unsigned char	sum = 0;
+
+				packet = input.substr(start + 1, end - start - 1);
+				for (size_t index = 0; index < packet.size(); ++index)
+					sum += packet[index];
+
+				bool	valid = (strtoul(input.substr(end + 1, 2).c_str(), NULL, 16) == sum);
+
+				input.erase(0, end + 3);
+				if (acking && (::send(client, valid ? "+" : "-", 1, MSG_NOSIGNAL) < 0))
+					return (false);
+				if (valid) return (true);
+				continue;
+			}
+		}
+		else
+			input.clear();
+
+		char	buffer[PACKET_SIZE];
+		ssize_t	count = recv(client, buffer, sizeof(buffer), 0);
+
+		if (count <= 0) return (false);
+		input.append(buffer, count);
+	}
+#else
+	return (false);
+#endif
+}
+
+// Frame and send a reply
+bool gdb816::send(const string &packet)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	unsigned char	sum = 0;
+
+	for (size_t index = 0; index < packet.size(); ++index)
+		sum += packet[index];
+
+	string	frame = "$" + packet + "#" + toLittle(sum, 1);
+
+	for (size_t sent = 0; sent < frame.size(); ) {
+		ssize_t	count = ::send(client, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+
+		if (count <= 0) return (false);
+		sent += count;
+	}
+	return (true);
+#else
+	return (false);
+#endif
+}
+
+// Check the socket for an interrupt from the client without blocking, or
+// waiting a little if the guest is idle. A client hanging up counts too.
+bool gdb816::interrupted()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	pollfd	fd;
+
+	fd.fd = client;
+	fd.events = POLLIN;
+	fd.revents = 0;
+	if (poll(&fd, 1, emu816::isWaiting() ? IDLE_MS : 0) <= 0) return (false);
+
+	char	buffer[PACKET_SIZE];
+	ssize_t	count = recv(client, buffer, sizeof(buffer), 0);
+
+	if (count <= 0) return (true);
+	input.append(buffer, count);
+
+	size_t	brk = input.find('\x03');
+
+	if (brk == string::npos) return (false);
+	input.erase(brk, 1);
+	return (true);
+#else
+	return (false);
+#endif
+}
+
+// Act on a packet and return the reply. Unsupported packets get an empty
+// reply, which tells the client to fall back on something simpler.
+string gdb816::handle(const string &packet, bool &done, bool &detach)
+{
+	if (packet.empty()) return ("");
+
+	string	args = packet.substr(1);
+
+	switch (packet[0]) {
+	case '?':	return (stopReply());
+	case 'g':	return (readRegisters());
+	case 'm':	return (readMemory(args));
+	case 'M':	return (writeMemory(args) ? "OK" : "E01");
+	case 'c':
+	case 's':
+		if (!args.empty()
+				&& !writeRegister(REG_PC, toLittle(strtoul(args.c_str(), NULL, 16), 4)))
+			return ("E01");
+		return (proceed(packet[0] == 's'));
+	case 'C':
+	case 'S':
+		return (proceed(packet[0] == 'S'));
+	case 'Z':	return (setPoint(args, true) ? "OK" : "");
+	case 'z':	return (setPoint(args, false) ? "OK" : "");
+	case 'H':	return ("OK");
+	case 'T':	return ("OK");
+
+	case 'G':
+		for (unsigned int reg = 0, offset = 0; reg < REGS; offset += 2 * sizes[reg++])
+			if (!writeRegister(reg, args.substr(offset))) return ("E01");
+		return ("OK");
+
+	case 'p':
+		{
+			unsigned int	reg = strtoul(args.c_str(), NULL, 16);
+			unsigned int	offset = 0;
+
+			if (reg >= REGS) return ("E01");
+			for (unsigned int index = 0; index < reg; ++index)
+				offset += 2 * sizes[index];
+			return (readRegisters().substr(offset, 2 * sizes[reg]));
+		}
+
+	case 'P':
+		{
+			size_t	equals = args.find('=');
+
+			if ((equals == string::npos)
+					|| !writeRegister(strtoul(args.c_str(), NULL, 16), args.substr(equals + 1)))
+				return ("E01");
+			return ("OK");
+		}
+
+	case 'D':
+		done = detach = true;
+		return ("OK");
+
+	case 'k':
+		done = true;
+		return ("");
+
+	case 'q':
+		if (packet.compare(0, 10, "qSupported") == 0)
+			return ("PacketSize=1000;qXfer:features:read+;swbreak+;hwbreak+;QStartNoAckMode+");
+		if (packet == "qAttached") return ("1");
+		if (packet == "qC") return ("QC1");
+		if (packet == "qfThreadInfo") return ("m1");
+		if (packet == "qsThreadInfo") return ("l");
+		if (packet.compare(0, sizeof(XFER_TARGET) - 1, XFER_TARGET) == 0)
+			return (describe(packet.substr(sizeof(XFER_TARGET) - 1)));
+		return ("");
+
+	case 'Q':
+		if (packet == "QStartNoAckMode") return ("OK");
+		return ("");
+	}
+	return ("");
+}
+
+//==============================================================================
+// Execution
+//------------------------------------------------------------------------------
+
+// Step one instruction or run in quanta until the guest stops, checking for
+// an interrupt from the client between quanta.
+string gdb816::proceed(bool single)
+{
+	emu816::resume();
+
+	if (single)
+		emu816::step();
+	else
+		do {
+			emu816::run(quantum);
+			if (emu816::isStopped()) break;
+			if (interrupted()) return ("S02");
+		} while (true);
+
+	return (stopReply());
+}
+
+// Describe why the guest last stopped
+string gdb816::stopReply() const
+{
+	if (emu816::getBreak() != emu816::NO_BREAK)
+		return ("T05swbreak:;");
+
+	if (emu816::isPaused()) {
+		const char *kind = watchWrite ? "watch" : "rwatch";
+
+		for (size_t index = 0; index < watches.size(); ++index)
+			if ((watches[index].start <= watchAddr) && (watchAddr <= watches[index].end)
+					&& (watches[index].kinds == (mem816::WATCH_READ | mem816::WATCH_WRITE)))
+				kind = "awatch";
+
+		return (string("T05") + kind + ":" + toHex(watchAddr, 6) + ";");
+	}
+
+	if (emu816::isStopped())
+		return ("W00");
+
+	return ("S05");
+}
+
+// Note a watch hit and stop once the instruction completes
+void gdb816::onWatch(Addr ea, Byte, Byte, bool write)
+{
+	watchAddr = ea;
+	watchWrite = write;
+	emu816::pause();
+}
+
+//==============================================================================
+// Registers and Memory
+//------------------------------------------------------------------------------
+
+// Format all the registers for a 'g' packet
+string gdb816::readRegisters() const
+{
+	emu816::State	state;
+
+	emu816::save(state);
+	return (toLittle(state.a, 2) + toLittle(state.x, 2) + toLittle(state.y, 2)
+		+ toLittle(state.sp, 2) + toLittle(state.dp, 2)
+		+ toLittle(join(state.pbr, state.pc), 4) + toLittle(state.dbr, 1)
+		+ toLittle(state.p, 1) + toLittle(state.e, 1));
+}
+
+// Change one register from its hex value
+bool gdb816::writeRegister(unsigned int reg, const string &hex)
+{
+	if ((reg >= REGS) || (hex.size() < 2 * sizes[reg])) return (false);
+
+	emu816::State	state;
+	unsigned long	value = fromLittle(hex, sizes[reg]);
+
+	emu816::save(state);
+	switch (reg) {
+	case REG_A:		state.a = (Word) value; break;
+	case REG_X:		state.x = (Word) value; break;
+	case REG_Y:		state.y = (Word) value; break;
+	case REG_SP:	state.sp = (Word) value; break;
+	case REG_DP:	state.dp = (Word) value; break;
+	case REG_PC:	state.pc = (Word) value; state.pbr = (Byte)(value >> 16); break;
+	case REG_DBR:	state.dbr = (Byte) value; break;
+	case REG_P:		state.p = (Byte) value; break;
+	case REG_E:		state.e = value & 1; break;
+	}
+	emu816::restore(state);
+	return (true);
+}
+
+// Read memory for an 'm addr,length' packet
+string gdb816::readMemory(const string &args) const
+{
+	char		   *next;
+	Addr			addr = strtoul(args.c_str(), &next, 16);
+	unsigned long	length = (*next == ',') ? strtoul(next + 1, NULL, 16) : 0;
+	string			hex;
+
+	if (length > PACKET_SIZE / 2) length = PACKET_SIZE / 2;
+	while (length--)
+		hex += toLittle(emu816::peekByte(addr++ & 0xffffff), 1);
+	return (hex);
+}
+
+// Write memory for an 'M addr,length:bytes' packet
+bool gdb816::writeMemory(const string &args)
+{
+	char		   *next;
+	Addr			addr = strtoul(args.c_str(), &next, 16);
+	unsigned long	length = (*next == ',') ? strtoul(next + 1, &next, 16) : 0;
+
+	if (*next++ != ':') return (false);
+
+	string			hex(next);
+
+	if (hex.size() < 2 * length) return (false);
+	for (unsigned long index = 0; index < length; ++index)
+		emu816::pokeByte((addr + index) & 0xffffff, (Byte) fromLittle(hex.substr(2 * index), 1));
+	return (true);
+}
+
+// Insert or remove a breakpoint or watchpoint for a 'Z' or 'z' packet of the
+// form type,addr,kind. Software and hardware breakpoints are both fetch traps
+// and the kind of a watchpoint is its length in bytes.
+bool gdb816::setPoint(const string &args, bool insert)
+{
+	char		   *next;
+	unsigned long	type = strtoul(args.c_str(), &next, 10);
+	Addr			addr = (*next == ',') ? strtoul(next + 1, &next, 16) & 0xffffff : 0;
+	unsigned long	kind = (*next == ',') ? strtoul(next + 1, NULL, 16) : 1;
+
+	if (type <= 1) {
+		if (insert)
+			breakpoints.insert(addr);
+		else
+			breakpoints.erase(addr);
+		emu816::setBreakpoints(breakpoints.empty() ? NULL : &breakpoints);
+		return (true);
+	}
+
+	if (type > 4) return (false);
+
+	mem816::Watch	watch;
+
+	watch.start = addr;
+	watch.end = addr + (kind ? kind - 1 : 0);
+	watch.kinds = (type == 2) ? mem816::WATCH_WRITE
+		: (type == 3) ? mem816::WATCH_READ : mem816::WATCH_READ | mem816::WATCH_WRITE;
+
+	if (insert)
+		watches.push_back(watch);
+	else
+		for (size_t index = 0; index < watches.size(); ++index)
+			if ((watches[index].start == watch.start) && (watches[index].end == watch.end)
+					&& (watches[index].kinds == watch.kinds)) {
+				watches.erase(watches.begin() + index);
+				break;
+			}
+
+	emu816::setWatches(watches.empty() ? NULL : &watches, onWatch);
+	return (true);
+}
+
+// Return part of the target description for a ':offset,length' request
+string gdb816::describe(const string &args) const
+{
+	char		   *next;
+	unsigned long	offset = strtoul(args.c_str() + 1, &next, 16);
+	unsigned long	length = (*next == ',') ? strtoul(next + 1, NULL, 16) : 0;
+	string			xml(targetXML);
+
+	if (offset >= xml.size()) return ("l");
+	if (offset + length >= xml.size()) return ("l" + xml.substr(offset));
+	return ("m" + xml.substr(offset, length));
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef GDB816_H
+#define GDB816_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mem816.h"
+
+// The gdb816 class lets GDB, or any other client speaking the GDB remote
+// serial protocol, debug a guest over a local TCP port or a Unix domain
+// socket. Between stops the processor runs at full speed in quanta and the
+// socket is only polled between them for an interrupt from the client, never
+// per instruction. Breakpoints and watchpoints use the emulator's own fetch
+// traps and watched pages, so they cost nothing elsewhere in memory.
+//
+// Registers are A, X, Y, SP and DP as 16-bit values, PC as a 32-bit value
+// holding the full 24-bit address with PBR in bits 16-23, then DBR, P and E
+// as 8-bit values, all little endian. A matching target description is
+// served to clients that ask for one.
+
+class gdb816 :
+	public wdc816
+{
+public:
+	// Listen on "unix:path" or a TCP port number on the loopback interface
+	gdb816(const char *target, unsigned long quantum);
+	~gdb816();
+
+	// Open the socket and wait for a client to connect
+	bool open();
+
+	// Answer the client until it detaches, kills the guest or hangs up, or
+	// the guest stops itself. Returns true if the guest should carry on
+	// running without the debugger.
+	bool serve();
+
+private:
+	std::string			target;
+	unsigned long		quantum;
+	int					listener;				// Socket or -1
+	int					client;					// Connection or -1
+	bool				acking;					// Acknowledge packets
+	std::string			input;					// Unread bytes from the client
+
+	std::set<Addr>				breakpoints;
+	std::vector<mem816::Watch>	watches;
+
+	static THREAD_LOCAL Addr	watchAddr;		// Last watch hit
+	static THREAD_LOCAL bool	watchWrite;
+
+	bool receive(std::string &packet);
+	bool send(const std::string &packet);
+	bool interrupted();
+
+	std::string handle(const std::string &packet, bool &done, bool &detach);
+	std::string proceed(bool single);
+	std::string stopReply() const;
+
+	std::string readRegisters() const;
+	bool writeRegister(unsigned int reg, const std::string &hex);
+	std::string readMemory(const std::string &args) const;
+	bool writeMemory(const std::string &args);
+	bool setPoint(const std::string &args, bool insert);
+	std::string describe(const std::string &args) const;
+
+	static void onWatch(Addr ea, Byte before, Byte after, bool write);
+
+	gdb816(const gdb816 &);
+	gdb816 &operator =(const gdb816 &);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,211 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+#include "emu816.h"
+#include "journal816.h"
+
+// Identifies a journal file
+static const char magic[4] = { 'J', '8', '1', '6' };
+
+// The size of an event on disk: the cycles in little endian then kind and value
+#define EVENT_SIZE	10
+
+// Events buffered before being written
+#define BUFFERED	4096
+
+//==============================================================================
+
+// Create an idle journal
+journal816::journal816()
+	: replaying(false), nextInput(0), nextInterrupt(0), divergences(0)
+{ }
+
+// Flush any outstanding events
+journal816::~journal816()
+{
+	if (!replaying && file.is_open()) flush();
+}
+
+//==============================================================================
+// Journal Files
+//------------------------------------------------------------------------------
+
+// Create the journal file and start buffering events
+bool journal816::record(const char *filename)
+{
+	file.open(filename, ios::binary | ios::trunc);
+	if (!file.is_open()) return (false);
+
+	replaying = false;
+	events.clear();
+	file.write(magic, sizeof(magic));
+	return (file.good());
+}
+
+// Read all the events of a journal file
+bool journal816::replay(const char *filename)
+{
+	ifstream	input(filename, ios::binary);
+	char		header[sizeof(magic)];
+	Byte		data[EVENT_SIZE];
+
+	if (!input.read(header, sizeof(header))) return (false);
+	for (unsigned int index = 0; index < sizeof(magic); ++index)
+		if (header[index] != magic[index]) return (false);
+
+	events.clear();
+	while (input.read((char *) data, EVENT_SIZE)) {
+		Event	event;
+
+		event.cycles = 0;
+		for (int index = 7; index >= 0; --index)
+			event.cycles = (event.cycles << 8) | data[index];
+		event.kind = data[8];
+		event.value = data[9];
+		events.push_back(event);
+	}
+
+	replaying = true;
+	nextInput = nextInterrupt = 0;
+	divergences = 0;
+	return (true);
+}
+
+// Mark the end of a recorded run and write out the remaining events
+bool journal816::close(unsigned long long cycles)
+{
+	if (replaying || !file.is_open()) return (true);
+
+	log(cycles, FINISH, 0);
+
+	bool	ok = flush();
+
+	file.close();
+	return (ok);
+}
+
+// Buffer an event, writing the buffer out when full
+void journal816::log(unsigned long long cycles, Byte kind, Byte value)
+{
+	Event	event;
+
+	event.cycles = cycles;
+	event.kind = kind;
+	event.value = value;
+	events.push_back(event);
+
+	if (events.size() >= BUFFERED) flush();
+}
+
+// Write the buffered events to the file
+bool journal816::flush()
+{
+	Byte	data[EVENT_SIZE];
+
+	for (size_t index = 0; index < events.size(); ++index) {
+		unsigned long long cycles = events[index].cycles;
+
+		for (int byte = 0; byte < 8; ++byte, cycles >>= 8)
+			data[byte] = (Byte) cycles;
+		data[8] = events[index].kind;
+		data[9] = events[index].value;
+		file.write((const char *) data, EVENT_SIZE);
+	}
+	events.clear();
+	return (file.good());
+}
+
+//==============================================================================
+// Recording and Replaying
+//------------------------------------------------------------------------------
+
+// Supply the result of a WDM #$02. When replaying the value is only changed if
+// the recorded read succeeded, just as for a failed stream read.
+void journal816::read(istream &in, unsigned long long cycles, Byte &value)
+{
+	if (replaying) {
+		while ((nextInput < events.size()) && (events[nextInput].kind == INTERRUPT))
+			++nextInput;
+
+		if ((nextInput < events.size()) && (events[nextInput].kind <= EMPTY)) {
+			const Event &event = events[nextInput++];
+
+			if (event.cycles != cycles) ++divergences;
+			if (event.kind == INPUT) value = event.value;
+		}
+		else
+			++divergences;
+	}
+	else {
+		if (in >> value)
+			log(cycles, INPUT, value);
+		else
+			log(cycles, EMPTY, 0);
+	}
+}
+
+// Replay the recorded run. The emulator is run in bursts that end exactly at
+// the cycle of the next interrupt, which is then delivered. A processor parked
+// in WAI or STP is stepped, as it was when recorded, until then.
+void journal816::play()
+{
+	unsigned long long finish = ~0ULL;
+
+	if (!events.empty() && (events.back().kind == FINISH))
+		finish = events.back().cycles;
+
+	while (!emu816::isStopped() && (emu816::getCycles() < finish)) {
+		unsigned long long until = finish;
+
+		while ((nextInterrupt < events.size()) &&
+				(events[nextInterrupt].kind != INTERRUPT))
+			++nextInterrupt;
+
+		if (nextInterrupt < events.size()) {
+			const Event &event = events[nextInterrupt];
+
+			// A running processor may pass the cycle by the length of a fused
+			// sequence, which cannot contain the WAI or STP that would see the
+			// interrupt, but a parked one must be woken exactly on time.
+			if (emu816::getCycles() >= event.cycles) {
+				if (emu816::isWaiting() && (emu816::getCycles() != event.cycles))
+					++divergences;
+				++nextInterrupt;
+				emu816::interrupt();
+				continue;
+			}
+			until = event.cycles;
+		}
+
+		if (emu816::isWaiting()) {
+			if (until == ~0ULL) break;
+			emu816::step();
+		}
+		else
+			emu816::run(until - emu816::getCycles());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef JOURNAL816_H
+#define JOURNAL816_H
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "wdc816.h"
+
+// The journal816 class records every input the outside world gives a guest,
+// namely the bytes read by WDM #$02 and the interrupts delivered, each tagged
+// with the cycle count at which it happened. Replaying the journal feeds the
+// same inputs back at the same cycles so that a run can be reproduced exactly,
+// for example to profile it repeatedly.
+
+class journal816 :
+	public wdc816
+{
+public:
+	// The kinds of event logged
+	enum Kind {
+		INPUT = 1,						// A byte read by WDM #$02
+		EMPTY,							// A WDM #$02 read with no input
+		INTERRUPT,						// An interrupt delivered
+		FINISH							// The end of the recorded run
+	};
+
+	// A logged event
+	struct Event {
+		unsigned long long cycles;
+		Byte			kind;
+		Byte			value;
+	};
+
+	journal816();
+	~journal816();
+
+	// Start recording to a file
+	bool record(const char *filename);
+
+	// Load a recording to replay
+	bool replay(const char *filename);
+
+	// Log the end of the run and flush a recording
+	bool close(unsigned long long cycles);
+
+	// Handle a WDM #$02 read, taking the input from the stream when recording
+	// or from the journal when replaying
+	void read(std::istream &in, unsigned long long cycles, Byte &value);
+
+	// Note an interrupt being delivered
+	INLINE void interrupt(unsigned long long cycles)
+	{
+		if (!replaying) log(cycles, INTERRUPT, 0);
+	}
+
+	// Run the attached emulator to the end of the recording, delivering the
+	// interrupts at their logged cycles
+	void play();
+
+	INLINE bool isReplaying() const
+	{
+		return (replaying);
+	}
+
+	// The number of events that did not match the execution when replayed
+	INLINE unsigned long getDivergences() const
+	{
+		return (divergences);
+	}
+
+private:
+	bool				replaying;
+	std::ofstream		file;
+	std::vector<Event>	events;			// Buffered or loaded events
+	size_t				nextInput;		// Next input to replay
+	size_t				nextInterrupt;	// Next interrupt to replay
+	unsigned long		divergences;
+
+	void log(unsigned long long cycles, Byte kind, Byte value);
+	bool flush();
+};
+#endif
\ No newline at end of file
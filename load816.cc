@@ -0,0 +1,110 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <fstream>
+#include <string>
+
+using namespace std;
+
+#include "load816.h"
+
+//==============================================================================
+
+// Never used.
+load816::load816()
+{ }
+
+// Never used.
+load816::~load816()
+{ }
+
+//==============================================================================
+// S19/28 Record Parsing
+//------------------------------------------------------------------------------
+
+static unsigned int toNybble(char ch)
+{
+	if ((ch >= '0') && (ch <= '9')) return (ch - '0');
+	if ((ch >= 'A') && (ch <= 'F')) return (ch - 'A' + 10);
+	if ((ch >= 'a') && (ch <= 'f')) return (ch - 'a' + 10);
+	return (0);
+}
+
+static unsigned int toByte(string &str, int &offset)
+{
+	unsigned int	h = toNybble(str[offset++]) << 4;
+	unsigned int	l = toNybble(str[offset++]);
+
+	return (h | l);
+}
+
+static unsigned int toWord(string &str, int &offset)
+{
+	unsigned int	h = toByte(str, offset) << 8;
+	unsigned int	l = toByte(str, offset);
+
+	return (h | l);
+}
+
+static unsigned long toAddr(string &str, int &offset)
+{
+	unsigned long	h = toByte(str, offset) << 16;
+	unsigned long	m = toByte(str, offset) << 8;
+	unsigned long	l = toByte(str, offset);
+
+	return (h | m | l);
+}
+
+//==============================================================================
+
+// Load the data records of an S19/28 file into memory
+bool load816::load(const char *filename)
+{
+	ifstream	file(filename);
+	string	line;
+
+	if (!file.is_open()) return (false);
+
+	while (file >> line) {
+		if (line[0] == 'S') {
+			int offset = 2;
+
+			if (line[1] == '1') {
+				unsigned int count = toByte(line, offset);
+				unsigned long addr = toWord(line, offset);
+				count -= 3;
+				while (count-- > 0) {
+					setByte(addr++, toByte(line, offset));
+				}
+			}
+			else if (line[1] == '2') {
+				unsigned int count = toByte(line, offset);
+				unsigned long addr = toAddr(line, offset);
+				count -= 4;
+				while (count-- > 0) {
+					setByte(addr++, toByte(line, offset));
+				}
+			}
+		}
+	}
+	file.close();
+	return (true);
+}
\ No newline at end of file
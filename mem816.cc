@@ -19,16 +19,73 @@
 // http://creativecommons.org/licenses/by-nc-sa/4.0/
 //------------------------------------------------------------------------------
 
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <set>
+
+using namespace std;
+
+#ifdef __linux__
+# include <sys/mman.h>
+#endif
+
 #include "mem816.h"
 
-mem816::Addr	mem816::memMask;
-mem816::Addr	mem816::ramSize;
+bool						mem816::hugePages = false;
+
+THREAD_LOCAL mem816::Addr	mem816::memMask;
+THREAD_LOCAL mem816::Addr	mem816::ramSize;
+
+THREAD_LOCAL mem816::Byte  *mem816::pRAM;
+THREAD_LOCAL const mem816::Byte *mem816::pROM;
+
+THREAD_LOCAL bool			mem816::slowPath;
+THREAD_LOCAL mem816::Space *mem816::pSpace;
+THREAD_LOCAL mem816::Heatmap *mem816::pHeat;
+
+THREAD_LOCAL const set<mem816::Addr> *mem816::pBreaks;
+THREAD_LOCAL mem816::Addr	mem816::skipBreak = ~0UL;
+THREAD_LOCAL mem816::Addr	mem816::trapAt = ~0UL;
+
+THREAD_LOCAL mem816::Byte  *mem816::pAttrs;
+THREAD_LOCAL const vector<mem816::Watch> *mem816::pWatches;
+THREAD_LOCAL mem816::Watcher mem816::watcher;
+THREAD_LOCAL mem816::Addr	mem816::watchMask = 0xffffff;
 
-mem816::Byte   *mem816::pRAM;
-const mem816::Byte *mem816::pROM;
+const mem816::Byte			mem816::zeroBank[0x10000] = { 0 };
+
+THREAD_LOCAL mem816::Addr	mem816::codePage = ~0UL;
+THREAD_LOCAL const mem816::Byte *mem816::pCode;
+
+THREAD_LOCAL mem816::Byte  *mem816::pDirty;
+THREAD_LOCAL mem816::Addr  *mem816::pDirtyPages;
+THREAD_LOCAL mem816::Addr	mem816::dirtyCount;
 
 //==============================================================================
 
+// Start with every bank reading as zero
+mem816::Space::Space()
+{
+	for (unsigned int bank = 0; bank < 256; ++bank) {
+		read[bank] = zeroBank;
+		write[bank] = NULL;
+	}
+	pool = NULL;
+	huge = hugePages;
+}
+
+// Release the banks that were written
+mem816::Space::~Space()
+{
+	if (pool)
+		freeRAM(pool, 0x1000000, true);
+	else
+		for (unsigned int bank = 0; bank < 256; ++bank)
+			delete [] write[bank];
+}
+
 // Never used.
 mem816::mem816()
 { }
@@ -37,10 +94,10 @@ mem816::mem816()
 mem816::~mem816()
 { }
 
-// Sets up the memory areas using a dynamically allocated array
+// Sets up the memory areas using a dynamically allocated (and cleared) array
 void mem816::setMemory(Addr memMask, Addr ramSize, const Byte *pROM)
 {
-	setMemory(memMask, ramSize, new Byte[ramSize], pROM);
+	setMemory(memMask, ramSize, allocRAM(ramSize, hugePages), pROM);
 }
 
 // Sets up the memory area using pre-allocated array
@@ -50,4 +107,390 @@ void mem816::setMemory(Addr memMask, Addr ramSize, Byte *pRAM, const Byte *pROM)
 	mem816::ramSize = ramSize;
 	mem816::pRAM = pRAM;
 	mem816::pROM = pROM;
+	mem816::pSpace = NULL;
+
+	markWatches();
+	updatePath();
+	codePage = ~0UL;
+}
+
+// Sets up a sparse 16M address space
+void mem816::setMemory(Space *pSpace)
+{
+	mem816::pSpace = pSpace;
+
+	markWatches();
+	updatePath();
+	codePage = ~0UL;
+}
+
+// Give the bank holding ea its own memory on its first write
+mem816::Byte *mem816::allocBank(Addr ea)
+{
+	register Byte	bank = lo(ea >> 16);
+	register Byte  *pBank;
+
+	if (pSpace->huge) {
+		if (!pSpace->pool) pSpace->pool = allocRAM(0x1000000, true);
+		pBank = pSpace->pool + bank * 0x10000;
+	}
+	else
+		pBank = new Byte[0x10000]();
+
+	pSpace->read[bank] = pSpace->write[bank] = pBank;
+
+	codePage = ~0UL;
+	return (pBank);
+}
+
+// Point the code cache at the page holding ea. Returns false, leaving the
+// cache empty, if the page does not lie wholly in RAM or wholly in ROM.
+bool mem816::mapCode(Addr ea)
+{
+	register Addr	page = ea & memMask & ~0xffUL;
+
+	codePage = ~0UL;
+	if (pHeat) return (false);
+	if (pBreaks) {
+		set<Addr>::const_iterator	next = pBreaks->lower_bound(ea & 0xffff00);
+
+		if ((next != pBreaks->end()) && (*next <= (ea & 0xffff00) + 0xff))
+			return (false);
+	}
+	if (pSpace) {
+		pCode = pSpace->read[lo(ea >> 16)] + ((Word) ea & 0xff00);
+		codePage = ea & ~0xffUL;
+		return (true);
+	}
+
+	if ((memMask & 0xff) != 0xff) return (false);
+
+	if (page + 0x100 <= ramSize)
+		pCode = pRAM + page;
+	else if ((page >= ramSize) && pROM)
+		pCode = pROM + (page - ramSize);
+	else
+		return (false);
+
+	codePage = ea & ~0xffUL;
+	return (true);
+}
+
+// Fetch a byte of code that the cache could not supply, counting it as a
+// fetch rather than a read when a heatmap is being kept and ignoring read
+// watches. An opcode fetch from a breakpoint returns the trap opcode, noting
+// where it did so, unless the breakpoint is being stepped over.
+mem816::Byte mem816::fetchByte(Addr ea, bool opcode)
+{
+	if (opcode && isBreakpoint(ea)) {
+		if ((ea & 0xffffff) != skipBreak) {
+			trapAt = ea & 0xffffff;
+			return (TRAP);
+		}
+		skipBreak = ~0UL;
+	}
+	if (opcode && ((ea & 0xffffff) == trapAt))
+		trapAt = ~0UL;
+
+	if (pHeat) count(pHeat->fetches, ea);
+	return (peekByte(ea));
+}
+
+// Write a byte as setByte does but without counting or watching it. The code
+// cache is dropped in case it held the page.
+void mem816::pokeByte(Addr ea, Byte data)
+{
+	codePage = ~0UL;
+
+	if (pSpace) {
+		register Byte  *pBank = pSpace->write[lo(ea >> 16)];
+
+		if (!pBank) pBank = allocBank(ea);
+		pBank[(Word) ea] = data;
+		if (pDirty) markDirty(ea & 0xffffff);
+		return;
+	}
+
+	if ((ea &= memMask) < ramSize) {
+		pRAM[ea] = data;
+		if (pDirty) markDirty(ea);
+	}
+}
+
+// Select the slow path for every access if anything needs to see them
+void mem816::updatePath()
+{
+	slowPath = (pSpace != NULL) || (pHeat != NULL) || (pAttrs != NULL);
+}
+
+//==============================================================================
+// Watchpoints
+//------------------------------------------------------------------------------
+
+// Test if a decoded address lies in a watched range, itself decoded
+static bool inRange(const mem816::Watch &watch, mem816::Addr ea, mem816::Addr mask)
+{
+	register mem816::Addr	start = watch.start & mask;
+
+	return ((start <= ea) && (ea - start <= watch.end - watch.start));
+}
+
+// Start or stop watching ranges of memory. The code cache is left alone as
+// instruction fetches are not watched.
+void mem816::setWatches(const vector<Watch> *watches, Watcher watcher)
+{
+	pWatches = (watches && !watches->empty()) ? watches : NULL;
+	mem816::watcher = watcher;
+
+	markWatches();
+	updatePath();
+}
+
+// Mark the pages holding each watched range in the attribute table. Flat
+// memory is indexed by the address it decodes to, so the table is rebuilt
+// whenever the memory is changed.
+void mem816::markWatches()
+{
+	delete [] pAttrs;
+	pAttrs = NULL;
+	watchMask = pSpace ? 0xffffff : (memMask & 0xffffff);
+
+	if (!pWatches) return;
+
+	pAttrs = new Byte[0x10000]();
+	for (size_t index = 0; index < pWatches->size(); ++index) {
+		const Watch &watch = (*pWatches)[index];
+
+		for (Addr addr = watch.start & ~0xffUL; addr <= watch.end; addr += 0x100)
+			pAttrs[(addr & watchMask) >> 8] |= watch.kinds;
+	}
+}
+
+// Read a byte from a watched page, reporting it if it lies in a watched range
+mem816::Byte mem816::watchRead(Addr ea)
+{
+	register Byte	data = peekByte(ea);
+
+	for (size_t index = 0; index < pWatches->size(); ++index) {
+		const Watch &watch = (*pWatches)[index];
+
+		if ((watch.kinds & WATCH_READ) && inRange(watch, ea & watchMask, watchMask)) {
+			watcher(ea & 0xffffff, data, data, false);
+			break;
+		}
+	}
+	return (data);
+}
+
+// Report a write to a watched page if it lies in a watched range. The write
+// itself is done by the caller.
+void mem816::watchWrite(Addr ea, Byte data)
+{
+	for (size_t index = 0; index < pWatches->size(); ++index) {
+		const Watch &watch = (*pWatches)[index];
+
+		if ((watch.kinds & WATCH_WRITE) && inRange(watch, ea & watchMask, watchMask)) {
+			watcher(ea & 0xffffff, peekByte(ea), data, true);
+			break;
+		}
+	}
+}
+
+// Start or stop trapping fetches from breakpoints
+void mem816::setBreakpoints(const set<Addr> *breakpoints)
+{
+	pBreaks = breakpoints;
+	skipBreak = ~0UL;
+	trapAt = ~0UL;
+
+	codePage = ~0UL;
+}
+
+// Start or stop logging the pages written to
+void mem816::setDirtyLog(Byte *flags, Addr *pages)
+{
+	pDirty = flags;
+	pDirtyPages = pages;
+	dirtyCount = 0;
+}
+
+// Clear the flags of the pages logged so far
+void mem816::clearDirty()
+{
+	while (dirtyCount > 0)
+		pDirty[pDirtyPages[--dirtyCount]] = 0;
+}
+
+// Huge pages are only requested on Linux. Elsewhere the option is ignored.
+void mem816::setHugePages(bool enable)
+{
+#ifdef __linux__
+	hugePages = enable;
+#else
+	(void) enable;
+#endif
+}
+
+// Allocate cleared memory for a guest. With huge set the memory is
+// mapped on a huge page boundary, from the reserved huge page pool if it can
+// be and otherwise with a request for transparent huge pages.
+mem816::Byte *mem816::allocRAM(Addr size, bool huge)
+{
+#ifdef __linux__
+	if (huge) {
+		register Addr	bytes = (size + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+		register void  *pMemory = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+		pMemory = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+		if (pMemory == MAP_FAILED) {
+			register Byte  *pBase = (Byte *) mmap(NULL, bytes + HUGE_PAGE,
+				PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if (pBase == MAP_FAILED) throw std::bad_alloc();
+
+			// Trim the mapping back to an aligned region
+			register Addr	skip = (HUGE_PAGE - ((Addr) pBase & (HUGE_PAGE - 1)))
+				& (HUGE_PAGE - 1);
+
+			if (skip) munmap(pBase, skip);
+			munmap(pBase + skip + bytes, HUGE_PAGE - skip);
+			pMemory = pBase + skip;
+#ifdef MADV_HUGEPAGE
+			madvise(pMemory, bytes, MADV_HUGEPAGE);
+#endif
+		}
+		return ((Byte *) pMemory);
+	}
+#else
+	(void) huge;
+#endif
+	return (new Byte[size]());
+}
+
+// Release memory obtained from allocRAM
+void mem816::freeRAM(Byte *pMemory, Addr size, bool huge)
+{
+	if (!pMemory) return;
+
+#ifdef __linux__
+	if (huge) {
+		munmap(pMemory, (size + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1));
+		return;
+	}
+#else
+	(void) size;
+	(void) huge;
+#endif
+	delete [] pMemory;
+}
+
+//==============================================================================
+// Heatmap
+//------------------------------------------------------------------------------
+
+// Start with no accesses counted
+mem816::Heatmap::Heatmap()
+{
+	fill(reads, reads + PAGES, 0UL);
+	fill(writes, writes + PAGES, 0UL);
+	fill(fetches, fetches + PAGES, 0UL);
+	fill(stamps, stamps + PAGES, 0UL);
+	window = 1;
+	accesses = 0;
+	current = 0;
+	peak = 0;
+}
+
+// Start or stop counting accesses
+void mem816::setHeatmap(Heatmap *heatmap)
+{
+	pHeat = heatmap;
+
+	updatePath();
+	codePage = ~0UL;
+}
+
+// Close the current working set window and start another
+void mem816::nextWindow()
+{
+	if (pHeat->current > pHeat->peak) pHeat->peak = pHeat->current;
+
+	++pHeat->window;
+	pHeat->accesses = 0;
+	pHeat->current = 0;
+}
+
+// Write the totals and working set, a line for each bank touched and then a
+// map of its pages, one character each, shaded by the log of their accesses.
+void mem816::Heatmap::report(ostream &out) const
+{
+	static const char	shades[] = " .:-=+*#%@";
+
+	unsigned long	totalReads = 0, totalWrites = 0, totalFetches = 0;
+	unsigned long	touched = 0;
+	unsigned long	mostPages = max(peak, current);
+
+	for (unsigned long page = 0; page < PAGES; ++page) {
+		totalReads += reads[page];
+		totalWrites += writes[page];
+		totalFetches += fetches[page];
+		if (reads[page] || writes[page] || fetches[page]) ++touched;
+	}
+
+	out << "Accesses: " << totalReads << " reads, " << totalWrites << " writes, "
+		<< totalFetches << " fetches" << endl;
+	out << "Pages touched: " << touched << " (" << touched / 4 << "K)" << endl;
+	out << "Peak working set: " << mostPages << " pages (" << mostPages / 4
+		<< "K) in " << (unsigned long) WINDOW << " accesses" << endl;
+
+	out << endl << "Bank  Pages       Reads      Writes     Fetches    R/W" << endl;
+	for (unsigned long bank = 0; bank < 256; ++bank) {
+		unsigned long	r = 0, w = 0, f = 0, pages = 0;
+
+		for (unsigned long page = bank << 8; page < (bank + 1) << 8; ++page) {
+			r += reads[page];
+			w += writes[page];
+			f += fetches[page];
+			if (reads[page] || writes[page] || fetches[page]) ++pages;
+		}
+		if (!pages) continue;
+
+		out << "  " << hex << setw(2) << setfill('0') << bank << dec << setfill(' ')
+			<< setw(7) << pages << setw(12) << r << setw(12) << w
+			<< setw(12) << f << "  ";
+		if (w)
+			out << fixed << setprecision(2) << (double) r / w << defaultfloat;
+		else
+			out << "-";
+		out << endl;
+	}
+
+	out << endl << "Heatmap (64 pages per line, '" << shades
+		<< "' by log4 of accesses):" << endl;
+	for (unsigned long bank = 0; bank < 256; ++bank) {
+		bool	used = false;
+
+		for (unsigned long page = bank << 8; page < (bank + 1) << 8; ++page)
+			if (reads[page] || writes[page] || fetches[page]) used = true;
+		if (!used) continue;
+
+		for (unsigned long row = bank << 8; row < (bank + 1) << 8; row += 64) {
+			out << hex << setw(2) << setfill('0') << bank << ':' << setw(4)
+				<< ((row & 0xff) << 8) << dec << setfill(' ') << " |";
+			for (unsigned long page = row; page < row + 64; ++page) {
+				unsigned long	total = reads[page] + writes[page] + fetches[page];
+				int				shade = 0;
+
+				while (total && (shade < 9)) {
+					total >>= 2;
+					++shade;
+				}
+				out << shades[shade];
+			}
+			out << '|' << endl;
+		}
+	}
 }
\ No newline at end of file
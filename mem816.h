@@ -22,22 +22,164 @@
 #ifndef MEM816_H
 #define MEM816_H
 
+#include <cstddef>
+#include <iosfwd>
+#include <set>
+#include <vector>
+
 #include "wdc816.h"
 
 // The mem816 class defines a set of standard methods for defining and accessing
-// the emulated memory area.
+// the emulated memory area. The memory configuration is held per thread so that
+// each worker thread can host its own emulated system.
 
 class mem816 :
 	public wdc816
 {
 public:
+	// The size of a host huge page
+	static const Addr HUGE_PAGE = 2 * 1024 * 1024;
+
+	// Back guest memory with huge pages where the host supports them. This
+	// should be chosen before any guest memory is allocated.
+	static void setHugePages(bool enable);
+
+	INLINE static bool isHugePages()
+	{
+		return (hugePages);
+	}
+
+	// Allocate cleared guest memory, mapped for huge pages if huge is set,
+	// and give it back again. The same setting must be used for both.
+	static Byte *allocRAM(Addr size, bool huge);
+	static void freeRAM(Byte *pMemory, Addr size, bool huge);
+
+	// A standard allocator that obtains its memory through allocRAM so that
+	// containers of guest memory can use huge pages. Whether it does is fixed
+	// when it is made so memory is always freed the way it was allocated.
+	template<class T> struct Allocator {
+		typedef T value_type;
+
+		bool	huge;
+
+		Allocator()
+			: huge(hugePages)
+		{ }
+
+		template<class U> Allocator(const Allocator<U> &other)
+			: huge(other.huge)
+		{ }
+
+		T *allocate(size_t count)
+		{
+			return ((T *) allocRAM(count * sizeof(T), huge));
+		}
+
+		void deallocate(T *pMemory, size_t count)
+		{
+			freeRAM((Byte *) pMemory, count * sizeof(T), huge);
+		}
+
+		bool operator ==(const Allocator &other) const
+		{
+			return (huge == other.huge);
+		}
+
+		bool operator !=(const Allocator &other) const
+		{
+			return (huge != other.huge);
+		}
+	};
+
+	typedef std::vector<Byte, Allocator<Byte> > RAM;
+
+	// A sparse 16M address space. Every bank reads as zero until it is first
+	// written, when it is given its own 64K of memory. With huge pages the
+	// banks are carved from one 16M reservation instead, if huge pages were
+	// enabled when the space was made.
+	struct Space {
+		const Byte	   *read[256];		// Per bank read pointers
+		Byte		   *write[256];		// Per bank memory or NULL
+		Byte		   *pool;			// Huge page reservation or NULL
+		bool			huge;			// Carve banks from the pool
+
+		Space();
+		~Space();
+
+	private:
+		Space(const Space &);
+		Space &operator =(const Space &);
+	};
+
+	// Counts of the reads, writes and instruction fetches made to each 256 byte
+	// page of the 16M address space. The working set is the number of pages
+	// touched in a window of accesses.
+	struct Heatmap {
+		enum { PAGES = 65536, WINDOW = 1 << 20 };
+
+		unsigned long	reads[PAGES];
+		unsigned long	writes[PAGES];
+		unsigned long	fetches[PAGES];
+		unsigned long	stamps[PAGES];		// Window each page was last seen in
+		unsigned long	window;				// The current window
+		unsigned long	accesses;			// ... the accesses made in it
+		unsigned long	current;			// ... and the pages they touched
+		unsigned long	peak;				// Most pages touched in any window
+
+		Heatmap();
+
+		// Write a summary per bank and a map of the pages
+		void report(std::ostream &out) const;
+	};
+
 	// Define the memory areas and sizes
 	static void setMemory (Addr memMask, Addr ramSize, const Byte *pROM);
 	static void setMemory (Addr memMask, Addr ramSize, Byte *pRAM, const Byte *pROM);
+	static void setMemory (Space *pSpace);
+
+	// The opcode fetched in place of an instruction at a breakpoint
+	static const Byte TRAP = 0x42;
+
+	// Trap opcode fetches from a set of addresses, or stop if NULL. The trap
+	// is substituted as the opcode is fetched so guest reads and writes, and
+	// operand fetches, still see the original memory. Pages holding a
+	// breakpoint are not put in the code cache; all other pages run at full
+	// speed.
+	static void setBreakpoints(const std::set<Addr> *breakpoints);
+
+	// The page attributes that mark a page as watched
+	enum { WATCH_READ = 0x01, WATCH_WRITE = 0x02 };
+
+	// A range of guest addresses (inclusive) to watch for reads or writes
+	struct Watch {
+		Addr			start;
+		Addr			end;
+		Byte			kinds;			// WATCH_READ and/or WATCH_WRITE
+	};
+
+	// Called for each watched access with the byte before and after it
+	typedef void (*Watcher)(Addr ea, Byte before, Byte after, bool write);
+
+	// Watch accesses to ranges of memory, or stop if NULL. Each page holding
+	// part of a range is marked in an attribute table and only accesses to
+	// marked pages are compared with the ranges.
+	static void setWatches(const std::vector<Watch> *watches, Watcher watcher);
+
+	// Count accesses into a heatmap, or stop if NULL. Whilst counting the
+	// code cache and host spans are disabled so every access is seen.
+	static void setHeatmap(Heatmap *heatmap);
 
 	// Fetch a byte from memory
 	INLINE static Byte getByte(Addr ea)
 	{
+		if (slowPath) {
+			if (pHeat) count(pHeat->reads, ea);
+			if (isWatched(ea, WATCH_READ))
+				return (watchRead(ea));
+			if (pSpace)
+				return (pSpace->read[lo(ea >> 16)][(Word) ea]);
+		}
+
 		if ((ea &= memMask) < ramSize)
 			return (pRAM[ea]);
 
@@ -56,13 +198,75 @@ public:
 		return (join(getByte(ea + 2), getWord(ea + 0)));
 	}
 
+	// Fetch a byte of code. The page holding the last fetch is remembered as a
+	// host pointer so sequential fetches need no address decoding.
+	INLINE static Byte getCodeByte(Addr ea)
+	{
+		if (((ea ^ codePage) & ~0xffUL) && !mapCode(ea))
+			return (fetchByte(ea, false));
+
+		return (pCode[ea & 0xff]);
+	}
+
+	// Fetch an opcode, which is the trap opcode at a breakpoint
+	INLINE static Byte getOpcode(Addr ea)
+	{
+		if (((ea ^ codePage) & ~0xffUL) && !mapCode(ea))
+			return (fetchByte(ea, true));
+
+		return (pCode[ea & 0xff]);
+	}
+
+	// Fetch a word of code
+	INLINE static Word getCodeWord(Addr ea)
+	{
+		return (join(getCodeByte(ea + 0), getCodeByte(ea + 1)));
+	}
+
+	// Fetch a long address from code
+	INLINE static Addr getCodeAddr(Addr ea)
+	{
+		return (join(getCodeByte(ea + 2), getCodeWord(ea + 0)));
+	}
+
 	// Write a byte to memory
 	INLINE static void setByte(Addr ea, Byte data)
 	{
-		if ((ea &= memMask) < ramSize)
+		if (slowPath) {
+			if (pHeat) count(pHeat->writes, ea);
+			if (isWatched(ea, WATCH_WRITE))
+				watchWrite(ea, data);
+			if (pSpace) {
+				register Byte  *pBank = pSpace->write[lo(ea >> 16)];
+
+				if (!pBank) pBank = allocBank(ea);
+				pBank[(Word) ea] = data;
+				if (pDirty) markDirty(ea & 0xffffff);
+				return;
+			}
+		}
+
+		if ((ea &= memMask) < ramSize) {
 			pRAM[ea] = data;
+			if (pDirty) markDirty(ea);
+		}
+	}
+
+	// Read a byte for a debugger without counting or watching it
+	INLINE static Byte peekByte(Addr ea)
+	{
+		if (pSpace)
+			return (pSpace->read[lo(ea >> 16)][(Word) ea]);
+
+		if ((ea &= memMask) < ramSize)
+			return (pRAM[ea]);
+
+		return (pROM[ea - ramSize]);
 	}
 
+	// Write a byte for a debugger without counting or watching it
+	static void pokeByte(Addr ea, Byte data);
+
 	// Write a word to memory
 	INLINE static void setWord(Addr ea, Word data)
 	{
@@ -70,15 +274,170 @@ public:
 			setByte(ea + 1, hi(data));
 	}
 
+	// Return a host pointer to count bytes of RAM starting at ea if they all
+	// lie within one 256 byte page, otherwise NULL.
+	INLINE static const Byte *getSpan(Addr ea, Addr count)
+	{
+		if ((ea & 0xff) + count > 0x100) return (NULL);
+
+		if (slowPath) {
+			if (pHeat) return (NULL);
+			if (isWatched(ea, WATCH_READ))
+				return (NULL);
+			if (pSpace)
+				return (pSpace->read[lo(ea >> 16)] + (Word) ea);
+		}
+
+		if ((ea &= memMask) + count > ramSize)
+			return (NULL);
+
+		return (pRAM + ea);
+	}
+
+	// As getSpan but for a span that is about to be written.
+	INLINE static Byte *setSpan(Addr ea, Addr count)
+	{
+		if ((ea & 0xff) + count > 0x100) return (NULL);
+
+		if (slowPath) {
+			if (pHeat) return (NULL);
+			if (isWatched(ea, WATCH_WRITE))
+				return (NULL);
+			if (pSpace) {
+				register Byte  *pBank = pSpace->write[lo(ea >> 16)];
+
+				if (!pBank) pBank = allocBank(ea);
+				if (pDirty) markDirty(ea & 0xffffff);
+				return (pBank + (Word) ea);
+			}
+		}
+
+		if ((ea &= memMask) + count > ramSize)
+			return (NULL);
+
+		if (pDirty) markDirty(ea);
+		return (pRAM + ea);
+	}
+
+	// Log the 256 byte RAM pages written to, or stop logging if flags is NULL.
+	// The flags array has one entry per page (65536 for a sparse space) and
+	// pages receives the number of each page the first time it is written.
+	static void setDirtyLog(Byte *flags, Addr *pages);
+
+	// The number of pages logged since the last clearDirty
+	INLINE static Addr getDirtyCount()
+	{
+		return (dirtyCount);
+	}
+
+	// Forget the logged pages
+	static void clearDirty();
+
+	// Return the RAM base and size of the current memory area
+	INLINE static Byte *getRAM()
+	{
+		return (pRAM);
+	}
+
+	INLINE static Addr getRAMSize()
+	{
+		return (ramSize);
+	}
+
 protected:
 	mem816();
 	~mem816();
 
+	// Test for a breakpoint at an address
+	INLINE static bool isBreakpoint(Addr ea)
+	{
+		return (pBreaks && pBreaks->count(ea & 0xffffff));
+	}
+
+	// Test if the opcode at an address was a trap substituted for it. Each
+	// trap is only reported once.
+	INLINE static bool isTrap(Addr ea)
+	{
+		if ((ea & 0xffffff) != trapAt) return (false);
+
+		trapAt = ~0UL;
+		return (true);
+	}
+
+	// Let the next fetch from a breakpoint address see the original opcode
+	INLINE static void stepOver(Addr ea)
+	{
+		skipBreak = ea & 0xffffff;
+	}
+
 private:
-	static Addr			memMask;		// The address mask pattern
-	static Addr			ramSize;		// The amount of RAM
+	static bool mapCode(Addr ea);
+	static Byte fetchByte(Addr ea, bool opcode);
+	static Byte *allocBank(Addr ea);
+	static void nextWindow();
+	static void updatePath();
+	static void markWatches();
+	static Byte watchRead(Addr ea);
+	static void watchWrite(Addr ea, Byte data);
+
+
+	// Test if the page holding ea is watched for a kind of access. Pages are
+	// indexed by the decoded address so aliases of a watched byte are seen.
+	INLINE static bool isWatched(Addr ea, Byte kind)
+	{
+		return (pAttrs && (pAttrs[(ea & watchMask) >> 8] & kind));
+	}
+
+	// Count an access to the page holding ea
+	INLINE static void count(unsigned long *counts, Addr ea)
+	{
+		register Addr	page = (ea & 0xffffff) >> 8;
+
+		++counts[page];
+		if (pHeat->stamps[page] != pHeat->window) {
+			pHeat->stamps[page] = pHeat->window;
+			++pHeat->current;
+		}
+		if (++pHeat->accesses == Heatmap::WINDOW) nextWindow();
+	}
+
+	// Note the first write to a RAM page
+	INLINE static void markDirty(Addr ea)
+	{
+		if (!pDirty[ea >>= 8]) {
+			pDirty[ea] = 1;
+			pDirtyPages[dirtyCount++] = ea;
+		}
+	}
+
+	static THREAD_LOCAL Addr		memMask;		// The address mask pattern
+	static THREAD_LOCAL Addr		ramSize;		// The amount of RAM
+
+	static THREAD_LOCAL Byte	   *pRAM;			// Base of RAM memory array
+	static THREAD_LOCAL const Byte *pROM;			// Base of ROM memory array
+
+	static bool						hugePages;		// Use huge pages if possible
+
+	static THREAD_LOCAL bool		slowPath;		// Sparse, counted or watched
+	static THREAD_LOCAL Space	   *pSpace;			// Sparse space or NULL
+	static THREAD_LOCAL Heatmap	   *pHeat;			// Access counts or NULL
+
+	static THREAD_LOCAL const std::set<Addr> *pBreaks;	// Breakpoints or NULL
+	static THREAD_LOCAL Addr		skipBreak;		// Breakpoint to step over
+	static THREAD_LOCAL Addr		trapAt;			// Last trap substituted
+
+	static THREAD_LOCAL Byte	   *pAttrs;			// Page attributes or NULL
+	static THREAD_LOCAL const std::vector<Watch> *pWatches;	// Ranges or NULL
+	static THREAD_LOCAL Watcher		watcher;		// Reports watched accesses
+	static THREAD_LOCAL Addr		watchMask;		// Decodes watched addresses
+
+	static const Byte				zeroBank[0x10000];	// Untouched bank contents
+
+	static THREAD_LOCAL Addr		codePage;		// Address of the cached page
+	static THREAD_LOCAL const Byte *pCode;			// Host copy of the cached page
 
-	static Byte		  *pRAM;			// Base of RAM memory array
-	static const Byte *pROM;			// Base of ROM memory array
+	static THREAD_LOCAL Byte	   *pDirty;			// Per page written flags
+	static THREAD_LOCAL Addr	   *pDirtyPages;	// Pages in order written
+	static THREAD_LOCAL Addr		dirtyCount;		// Number of pages written
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,426 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef OP816_H
+#define OP816_H
+
+#include "wdc816.h"
+
+// The op816 class holds a compile time table describing each of the 256
+// opcodes: its mnemonic, addressing mode, the status flags it reads and writes
+// and its base cycle count. Instruction lengths for each setting of the M and
+// X flags are derived from it during compilation. Tools that need to decode or
+// cost instructions (tracers, disassemblers or other execution engines) should
+// use this table rather than keep their own copy.
+//
+// The cycle counts are those charged by emu816 in native mode with the direct
+// page aligned, no page crossings and branches not taken. Read flags include M
+// or X when the operand size or result depends on them.
+//
+// The interpreter does not dispatch from this table. Instead check816 executes
+// every opcode in every mode and compares what it does with the table.
+
+class op816 :
+	public wdc816
+{
+public:
+	// Addressing modes, named after the emu816 functions that implement them
+	enum Mode {
+		ABSL,			// a
+		ABSX,			// a,X
+		ABSY,			// a,Y
+		ABSI,			// (a)
+		ABXI,			// (a,X)
+		ALNG,			// >a
+		ALNX,			// >a,X
+		ABIL,			// [a]
+		DPAG,			// d
+		DPGX,			// d,X
+		DPGY,			// d,Y
+		DPGI,			// (d)
+		DPIX,			// (d,X)
+		DPIY,			// (d),Y
+		DPIL,			// [d]
+		DILY,			// [d],Y
+		IMPL,			// Implied or stack
+		ACC,			// A
+		IMMB,			// #b
+		IMMW,			// #w (or the two banks of MVN/MVP)
+		IMMM,			// # sized by M
+		IMMX,			// # sized by X
+		LREL,			// Long relative
+		RELA,			// Relative
+		SREL,			// d,S
+		SRIY			// (d,S),Y
+	};
+
+	// Status register bits
+	enum {
+		F_C = 0x01, F_Z = 0x02, F_I = 0x04, F_D = 0x08,
+		F_X = 0x10, F_M = 0x20, F_V = 0x40, F_N = 0x80,
+		ALL = 0xff
+	};
+
+	// The description of an opcode
+	struct Info {
+		const char	   *mnemonic;
+		Mode			mode;
+		Byte			reads;			// Flags examined
+		Byte			writes;			// Flags that may change
+		Byte			cycles8;		// Base cycles with 8-bit registers
+		Byte			cycles16;		// Base cycles with 16-bit registers
+	};
+
+	static constexpr Info table[256] = {
+		{ "BRK", IMMB, ALL, F_D | F_I, 8, 8 },	// 00
+		{ "ORA", DPIX, F_M, F_N | F_Z, 5, 6 },	// 01
+		{ "COP", IMMB, ALL, F_D | F_I, 8, 8 },	// 02
+		{ "ORA", SREL, F_M, F_N | F_Z, 3, 4 },	// 03
+		{ "TSB", DPAG, F_M, F_Z, 5, 6 },	// 04
+		{ "ORA", DPAG, F_M, F_N | F_Z, 3, 4 },	// 05
+		{ "ASL", DPAG, F_M, F_N | F_Z | F_C, 5, 6 },	// 06
+		{ "ORA", DPIL, F_M, F_N | F_Z, 6, 7 },	// 07
+		{ "PHP", IMPL, ALL, 0, 3, 3 },	// 08
+		{ "ORA", IMMM, F_M, F_N | F_Z, 2, 4 },	// 09
+		{ "ASL", ACC, F_M, F_N | F_Z | F_C, 2, 2 },	// 0A
+		{ "PHD", IMPL, 0, 0, 4, 4 },	// 0B
+		{ "TSB", ABSL, F_M, F_Z, 6, 7 },	// 0C
+		{ "ORA", ABSL, F_M, F_N | F_Z, 4, 5 },	// 0D
+		{ "ASL", ABSL, F_M, F_N | F_Z | F_C, 6, 7 },	// 0E
+		{ "ORA", ALNG, F_M, F_N | F_Z, 5, 6 },	// 0F
+		{ "BPL", RELA, F_N, 0, 3, 3 },	// 10
+		{ "ORA", DPIY, F_M, F_N | F_Z, 5, 6 },	// 11
+		{ "ORA", DPGI, F_M, F_N | F_Z, 5, 6 },	// 12
+		{ "ORA", SRIY, F_M, F_N | F_Z, 5, 6 },	// 13
+		{ "TRB", DPAG, F_M, F_Z, 5, 6 },	// 14
+		{ "ORA", DPGX, F_M, F_N | F_Z, 3, 4 },	// 15
+		{ "ASL", DPGX, F_M, F_N | F_Z | F_C, 5, 6 },	// 16
+		{ "ORA", DILY, F_M, F_N | F_Z, 6, 7 },	// 17
+		{ "CLC", IMPL, 0, F_C, 2, 2 },	// 18
+		{ "ORA", ABSY, F_M, F_N | F_Z, 4, 5 },	// 19
+		{ "INC", ACC, F_M, F_N | F_Z, 2, 2 },	// 1A
+		{ "TCS", IMPL, 0, 0, 2, 2 },	// 1B
+		{ "TRB", ABSL, F_M, F_Z, 6, 7 },	// 1C
+		{ "ORA", ABSX, F_M, F_N | F_Z, 4, 5 },	// 1D
+		{ "ASL", ABSX, F_M, F_N | F_Z | F_C, 6, 7 },	// 1E
+		{ "ORA", ALNX, F_M, F_N | F_Z, 5, 6 },	// 1F
+		{ "JSR", ABSL, 0, 0, 6, 6 },	// 20
+		{ "AND", DPIX, F_M, F_N | F_Z, 5, 6 },	// 21
+		{ "JSL", ALNG, 0, 0, 8, 8 },	// 22
+		{ "AND", SREL, F_M, F_N | F_Z, 3, 4 },	// 23
+		{ "BIT", DPAG, F_M, F_N | F_V | F_Z, 3, 4 },	// 24
+		{ "AND", DPAG, F_M, F_N | F_Z, 3, 4 },	// 25
+		{ "ROL", DPAG, F_M | F_C, F_N | F_Z | F_C, 5, 6 },	// 26
+		{ "AND", DPIL, F_M, F_N | F_Z, 6, 7 },	// 27
+		{ "PLP", IMPL, 0, ALL, 4, 4 },	// 28
+		{ "AND", IMMM, F_M, F_N | F_Z, 2, 4 },	// 29
+		{ "ROL", ACC, F_M | F_C, F_N | F_Z | F_C, 2, 2 },	// 2A
+		{ "PLD", IMPL, 0, F_N | F_Z, 5, 5 },	// 2B
+		{ "BIT", ABSL, F_M, F_N | F_V | F_Z, 4, 5 },	// 2C
+		{ "AND", ABSL, F_M, F_N | F_Z, 4, 5 },	// 2D
+		{ "ROL", ABSL, F_M | F_C, F_N | F_Z | F_C, 6, 7 },	// 2E
+		{ "AND", ALNG, F_M, F_N | F_Z, 5, 6 },	// 2F
+		{ "BMI", RELA, F_N, 0, 3, 3 },	// 30
+		{ "AND", DPIY, F_M, F_N | F_Z, 5, 6 },	// 31
+		{ "AND", DPGI, F_M, F_N | F_Z, 5, 6 },	// 32
+		{ "AND", SRIY, F_M, F_N | F_Z, 5, 6 },	// 33
+		{ "BIT", DPGX, F_M, F_N | F_V | F_Z, 3, 4 },	// 34
+		{ "AND", DPGX, F_M, F_N | F_Z, 3, 4 },	// 35
+		{ "ROL", DPGX, F_M | F_C, F_N | F_Z | F_C, 5, 6 },	// 36
+		{ "AND", DILY, F_M, F_N | F_Z, 6, 7 },	// 37
+		{ "SEC", IMPL, 0, F_C, 2, 2 },	// 38
+		{ "AND", ABSY, F_M, F_N | F_Z, 4, 5 },	// 39
+		{ "DEC", ACC, F_M, F_N | F_Z, 2, 2 },	// 3A
+		{ "TSC", IMPL, F_M, F_N | F_Z, 2, 2 },	// 3B
+		{ "BIT", ABSX, F_M, F_N | F_V | F_Z, 4, 5 },	// 3C
+		{ "AND", ABSX, F_M, F_N | F_Z, 4, 5 },	// 3D
+		{ "ROL", ABSX, F_M | F_C, F_N | F_Z | F_C, 6, 7 },	// 3E
+		{ "AND", ALNX, F_M, F_N | F_Z, 5, 6 },	// 3F
+		{ "RTI", IMPL, 0, ALL, 7, 7 },	// 40
+		{ "EOR", DPIX, F_M, F_N | F_Z, 5, 6 },	// 41
+		{ "WDM", IMMB, 0, 0, 3, 3 },	// 42
+		{ "EOR", SREL, F_M, F_N | F_Z, 3, 4 },	// 43
+		{ "MVP", IMMW, F_X, 0, 8, 8 },	// 44
+		{ "EOR", DPAG, F_M, F_N | F_Z, 3, 4 },	// 45
+		{ "LSR", DPAG, F_M, F_N | F_Z | F_C, 5, 6 },	// 46
+		{ "EOR", DPIL, F_M, F_N | F_Z, 6, 7 },	// 47
+		{ "PHA", IMPL, F_M, 0, 3, 4 },	// 48
+		{ "EOR", IMMM, F_M, F_N | F_Z, 2, 4 },	// 49
+		{ "LSR", IMPL, F_M, F_N | F_Z | F_C, 2, 2 },	// 4A
+		{ "PHK", IMPL, 0, 0, 3, 3 },	// 4B
+		{ "JMP", ABSL, 0, 0, 3, 3 },	// 4C
+		{ "EOR", ABSL, F_M, F_N | F_Z, 4, 5 },	// 4D
+		{ "LSR", ABSL, F_M, F_N | F_Z | F_C, 6, 7 },	// 4E
+		{ "EOR", ALNG, F_M, F_N | F_Z, 5, 6 },	// 4F
+		{ "BVC", RELA, F_V, 0, 3, 3 },	// 50
+		{ "EOR", DPIY, F_M, F_N | F_Z, 5, 6 },	// 51
+		{ "EOR", DPGI, F_M, F_N | F_Z, 5, 6 },	// 52
+		{ "EOR", SRIY, F_M, F_N | F_Z, 5, 6 },	// 53
+		{ "MVN", IMMW, F_X, 0, 8, 8 },	// 54
+		{ "EOR", DPGX, F_M, F_N | F_Z, 3, 4 },	// 55
+		{ "LSR", DPGX, F_M, F_N | F_Z | F_C, 5, 6 },	// 56
+		{ "EOR", DPIL, F_M, F_N | F_Z, 6, 7 },	// 57
+		{ "CLI", IMPL, 0, F_I, 2, 2 },	// 58
+		{ "EOR", ABSY, F_M, F_N | F_Z, 4, 5 },	// 59
+		{ "PHY", IMPL, F_X, 0, 3, 4 },	// 5A
+		{ "TCD", IMPL, 0, F_N | F_Z, 2, 2 },	// 5B
+		{ "JMP", ALNG, 0, 0, 4, 4 },	// 5C
+		{ "EOR", ABSX, F_M, F_N | F_Z, 4, 5 },	// 5D
+		{ "LSR", ABSX, F_M, F_N | F_Z | F_C, 6, 7 },	// 5E
+		{ "EOR", ALNX, F_M, F_N | F_Z, 5, 6 },	// 5F
+		{ "RTS", IMPL, 0, 0, 6, 6 },	// 60
+		{ "ADC", DPIX, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 5 },	// 61
+		{ "PER", LREL, 0, 0, 8, 8 },	// 62
+		{ "ADC", SREL, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 3, 3 },	// 63
+		{ "STZ", DPAG, F_M, 0, 3, 4 },	// 64
+		{ "ADC", DPAG, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 3, 3 },	// 65
+		{ "ROR", DPAG, F_M | F_C, F_N | F_Z | F_C, 5, 6 },	// 66
+		{ "ADC", DPIL, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 6, 6 },	// 67
+		{ "PLA", IMPL, F_M, F_N | F_Z, 4, 5 },	// 68
+		{ "ADC", IMMM, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 2, 3 },	// 69
+		{ "ROR", IMPL, F_M | F_C, F_N | F_Z | F_C, 2, 2 },	// 6A
+		{ "RTL", IMPL, 0, 0, 6, 6 },	// 6B
+		{ "JMP", ABSI, 0, 0, 5, 5 },	// 6C
+		{ "ADC", ABSL, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 4, 4 },	// 6D
+		{ "ROR", ABSL, F_M | F_C, F_N | F_Z | F_C, 6, 7 },	// 6E
+		{ "ADC", ALNG, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 5 },	// 6F
+		{ "BVS", RELA, F_V, 0, 3, 3 },	// 70
+		{ "ADC", DPIY, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 5 },	// 71
+		{ "ADC", DPGI, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 5 },	// 72
+		{ "ADC", SRIY, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 5 },	// 73
+		{ "STZ", DPGX, F_M, 0, 3, 4 },	// 74
+		{ "ADC", DPGX, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 3, 3 },	// 75
+		{ "ROR", DPGX, F_M | F_C, F_N | F_Z | F_C, 5, 6 },	// 76
+		{ "ADC", DILY, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 6, 6 },	// 77
+		{ "SEI", IMPL, 0, F_I, 2, 2 },	// 78
+		{ "ADC", ABSY, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 4, 4 },	// 79
+		{ "PLY", IMPL, F_X, F_N | F_Z, 4, 5 },	// 7A
+		{ "TDC", IMPL, F_M, F_N | F_Z, 2, 2 },	// 7B
+		{ "JMP", ABXI, 0, 0, 5, 5 },	// 7C
+		{ "ADC", ABSX, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 4, 4 },	// 7D
+		{ "ROR", ABSX, F_M | F_C, F_N | F_Z | F_C, 6, 7 },	// 7E
+		{ "ADC", ALNX, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 5 },	// 7F
+		{ "BRA", RELA, 0, 0, 4, 4 },	// 80
+		{ "STA", DPIX, F_M, 0, 5, 6 },	// 81
+		{ "BRL", LREL, 0, 0, 5, 5 },	// 82
+		{ "STA", SREL, F_M, 0, 3, 4 },	// 83
+		{ "STY", DPAG, F_X, 0, 3, 4 },	// 84
+		{ "STA", DPAG, F_M, 0, 3, 4 },	// 85
+		{ "STX", DPAG, F_X, 0, 3, 4 },	// 86
+		{ "STA", DPIL, F_M, 0, 6, 7 },	// 87
+		{ "DEY", IMPL, F_X, F_N | F_Z, 2, 2 },	// 88
+		{ "BIT", IMMM, F_M, F_Z, 2, 3 },	// 89
+		{ "TXA", IMPL, F_M, F_N | F_Z, 2, 2 },	// 8A
+		{ "PHB", IMPL, 0, 0, 3, 3 },	// 8B
+		{ "STY", ABSL, F_X, 0, 4, 5 },	// 8C
+		{ "STA", ABSL, F_M, 0, 4, 5 },	// 8D
+		{ "STX", ABSL, F_X, 0, 4, 5 },	// 8E
+		{ "STA", ALNG, F_M, 0, 5, 6 },	// 8F
+		{ "BCC", RELA, F_C, 0, 3, 3 },	// 90
+		{ "STA", DPIY, F_M, 0, 5, 6 },	// 91
+		{ "STA", DPGI, F_M, 0, 5, 6 },	// 92
+		{ "STA", SRIY, F_M, 0, 5, 6 },	// 93
+		{ "STY", DPGX, F_X, 0, 3, 4 },	// 94
+		{ "STA", DPGX, F_M, 0, 3, 4 },	// 95
+		{ "STX", DPGY, F_X, 0, 3, 4 },	// 96
+		{ "STA", DILY, F_M, 0, 6, 7 },	// 97
+		{ "TYA", IMPL, F_M, F_N | F_Z, 2, 2 },	// 98
+		{ "STA", ABSY, F_M, 0, 4, 5 },	// 99
+		{ "TXS", IMPL, 0, 0, 2, 2 },	// 9A
+		{ "TXY", IMPL, F_X, F_N | F_Z, 2, 2 },	// 9B
+		{ "STZ", ABSL, F_M, 0, 4, 5 },	// 9C
+		{ "STA", ABSX, F_M, 0, 4, 5 },	// 9D
+		{ "STZ", ABSX, F_M, 0, 4, 5 },	// 9E
+		{ "STA", ALNX, F_M, 0, 5, 6 },	// 9F
+		{ "LDY", IMMX, F_X, F_N | F_Z, 2, 4 },	// A0
+		{ "LDA", DPIX, F_M, F_N | F_Z, 5, 6 },	// A1
+		{ "LDX", IMMX, F_X, F_N | F_Z, 2, 4 },	// A2
+		{ "LDA", SREL, F_M, F_N | F_Z, 3, 4 },	// A3
+		{ "LDY", DPAG, F_X, F_N | F_Z, 3, 4 },	// A4
+		{ "LDA", DPAG, F_M, F_N | F_Z, 3, 4 },	// A5
+		{ "LDX", DPAG, F_X, F_N | F_Z, 3, 4 },	// A6
+		{ "LDA", DPIL, F_M, F_N | F_Z, 6, 7 },	// A7
+		{ "TAY", IMPL, F_X, F_N | F_Z, 2, 2 },	// A8
+		{ "LDA", IMMM, F_M, F_N | F_Z, 2, 4 },	// A9
+		{ "TAX", IMPL, F_X, F_N | F_Z, 2, 2 },	// AA
+		{ "PLB", IMPL, 0, F_N | F_Z, 4, 4 },	// AB
+		{ "LDY", ABSL, F_X, F_N | F_Z, 4, 5 },	// AC
+		{ "LDA", ABSL, F_M, F_N | F_Z, 4, 5 },	// AD
+		{ "LDX", ABSL, F_X, F_N | F_Z, 4, 5 },	// AE
+		{ "LDA", ALNG, F_M, F_N | F_Z, 5, 6 },	// AF
+		{ "BCS", RELA, F_C, 0, 3, 3 },	// B0
+		{ "LDA", DPIY, F_M, F_N | F_Z, 5, 6 },	// B1
+		{ "LDA", DPGI, F_M, F_N | F_Z, 5, 6 },	// B2
+		{ "LDA", SRIY, F_M, F_N | F_Z, 5, 6 },	// B3
+		{ "LDY", DPGX, F_X, F_N | F_Z, 3, 4 },	// B4
+		{ "LDA", DPGX, F_M, F_N | F_Z, 3, 4 },	// B5
+		{ "LDX", DPGY, F_X, F_N | F_Z, 3, 4 },	// B6
+		{ "LDA", DILY, F_M, F_N | F_Z, 6, 7 },	// B7
+		{ "CLV", IMPL, 0, F_V, 2, 2 },	// B8
+		{ "LDA", ABSY, F_M, F_N | F_Z, 4, 5 },	// B9
+		{ "TSX", IMPL, F_X, F_N | F_Z, 2, 2 },	// BA
+		{ "TYX", IMPL, F_X, F_N | F_Z, 2, 2 },	// BB
+		{ "LDY", ABSX, F_X, F_N | F_Z, 4, 5 },	// BC
+		{ "LDA", ABSX, F_M, F_N | F_Z, 4, 5 },	// BD
+		{ "LDX", ABSY, F_X, F_N | F_Z, 4, 5 },	// BE
+		{ "LDA", ALNX, F_M, F_N | F_Z, 5, 6 },	// BF
+		{ "CPY", IMMX, F_X, F_N | F_Z | F_C, 2, 4 },	// C0
+		{ "CMP", DPIX, F_M, F_N | F_Z | F_C, 5, 6 },	// C1
+		{ "REP", IMMB, 0, ALL, 3, 3 },	// C2
+		{ "CMP", SREL, F_M, F_N | F_Z | F_C, 3, 4 },	// C3
+		{ "CPY", DPAG, F_X, F_N | F_Z | F_C, 3, 4 },	// C4
+		{ "CMP", DPAG, F_M, F_N | F_Z | F_C, 3, 4 },	// C5
+		{ "DEC", DPAG, F_M, F_N | F_Z, 5, 6 },	// C6
+		{ "CMP", DPIL, F_M, F_N | F_Z | F_C, 6, 7 },	// C7
+		{ "INY", IMPL, F_X, F_N | F_Z, 2, 2 },	// C8
+		{ "CMP", IMMM, F_M, F_N | F_Z | F_C, 2, 4 },	// C9
+		{ "DEX", IMPL, F_X, F_N | F_Z, 2, 2 },	// CA
+		{ "WAI", IMPL, 0, 0, 3, 3 },	// CB
+		{ "CPY", ABSL, F_X, F_N | F_Z | F_C, 4, 5 },	// CC
+		{ "CMP", ABSL, F_M, F_N | F_Z | F_C, 4, 5 },	// CD
+		{ "DEC", ABSL, F_M, F_N | F_Z, 6, 7 },	// CE
+		{ "CMP", ALNG, F_M, F_N | F_Z | F_C, 5, 6 },	// CF
+		{ "BNE", RELA, F_Z, 0, 3, 3 },	// D0
+		{ "CMP", DPIY, F_M, F_N | F_Z | F_C, 5, 6 },	// D1
+		{ "CMP", DPGI, F_M, F_N | F_Z | F_C, 5, 6 },	// D2
+		{ "CMP", SRIY, F_M, F_N | F_Z | F_C, 5, 6 },	// D3
+		{ "PEI", DPAG, 0, 0, 7, 7 },	// D4
+		{ "CMP", DPGX, F_M, F_N | F_Z | F_C, 3, 4 },	// D5
+		{ "DEC", DPGX, F_M, F_N | F_Z, 5, 6 },	// D6
+		{ "CMP", DILY, F_M, F_N | F_Z | F_C, 6, 7 },	// D7
+		{ "CLD", IMPL, 0, F_D, 2, 2 },	// D8
+		{ "CMP", ABSY, F_M, F_N | F_Z | F_C, 4, 5 },	// D9
+		{ "PHX", IMPL, F_X, 0, 3, 4 },	// DA
+		{ "STP", IMPL, 0, 0, 3, 3 },	// DB
+		{ "JMP", ABIL, 0, 0, 6, 6 },	// DC
+		{ "CMP", ABSX, F_M, F_N | F_Z | F_C, 4, 5 },	// DD
+		{ "DEC", ABSX, F_M, F_N | F_Z, 6, 7 },	// DE
+		{ "CMP", ALNX, F_M, F_N | F_Z | F_C, 5, 6 },	// DF
+		{ "CPX", IMMX, F_X, F_N | F_Z | F_C, 2, 4 },	// E0
+		{ "SBC", DPIX, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 6 },	// E1
+		{ "SEP", IMMB, 0, ALL, 3, 3 },	// E2
+		{ "SBC", SREL, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 3, 4 },	// E3
+		{ "CPX", DPAG, F_X, F_N | F_Z | F_C, 3, 4 },	// E4
+		{ "SBC", DPAG, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 3, 4 },	// E5
+		{ "INC", DPAG, F_M, F_N | F_Z, 5, 6 },	// E6
+		{ "SBC", DPIL, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 6, 7 },	// E7
+		{ "INX", IMPL, F_X, F_N | F_Z, 2, 2 },	// E8
+		{ "SBC", IMMM, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 2, 4 },	// E9
+		{ "NOP", IMPL, 0, 0, 2, 2 },	// EA
+		{ "XBA", IMPL, 0, F_N | F_Z, 3, 3 },	// EB
+		{ "CPX", ABSL, F_X, F_N | F_Z | F_C, 4, 5 },	// EC
+		{ "SBC", ABSL, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 4, 5 },	// ED
+		{ "INC", ABSL, F_M, F_N | F_Z, 6, 7 },	// EE
+		{ "SBC", ALNG, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 6 },	// EF
+		{ "BEQ", RELA, F_Z, 0, 3, 3 },	// F0
+		{ "SBC", DPIY, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 6 },	// F1
+		{ "SBC", DPGI, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 6 },	// F2
+		{ "SBC", SRIY, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 6 },	// F3
+		{ "PEA", IMMW, 0, 0, 6, 6 },	// F4
+		{ "SBC", DPGX, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 3, 4 },	// F5
+		{ "INC", DPGX, F_M, F_N | F_Z, 5, 6 },	// F6
+		{ "SBC", DILY, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 6, 7 },	// F7
+		{ "SED", IMPL, 0, F_D, 2, 2 },	// F8
+		{ "SBC", ABSY, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 4, 5 },	// F9
+		{ "PLX", IMPL, F_X, F_N | F_Z, 4, 5 },	// FA
+		{ "XCE", IMPL, F_C, F_M | F_X | F_C, 2, 2 },	// FB
+		{ "JSR", ABXI, 0, 0, 8, 8 },	// FC
+		{ "SBC", ABSX, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 4, 5 },	// FD
+		{ "INC", ABSX, F_M, F_N | F_Z, 6, 7 },	// FE
+		{ "SBC", ALNX, F_M | F_D | F_C, F_N | F_V | F_Z | F_C, 5, 6 }	// FF
+	};
+
+	// The number of operand bytes taken by an addressing mode
+	static constexpr unsigned int operands(Mode mode, bool m, bool x)
+	{
+		switch (mode) {
+		case IMPL:
+		case ACC:	return (0);
+		case IMMM:	return (m ? 1 : 2);
+		case IMMX:	return (x ? 1 : 2);
+		case ABSL:
+		case ABSX:
+		case ABSY:
+		case ABSI:
+		case ABXI:
+		case ABIL:
+		case IMMW:
+		case LREL:	return (2);
+		case ALNG:
+		case ALNX:	return (3);
+		default:	return (1);
+		}
+	}
+
+	// Instruction lengths for one setting of the M and X flags
+	struct Lengths {
+		Byte			bytes[256];
+	};
+
+	static constexpr Lengths lengths(bool m, bool x)
+	{
+		Lengths	result = {};
+
+		for (unsigned int opcode = 0; opcode < 256; ++opcode)
+			result.bytes[opcode] = (Byte)(1 + operands(table[opcode].mode, m, x));
+		return (result);
+	}
+
+	// The length tables indexed by M * 2 + X
+	static const Lengths byLength[4];
+
+	// The length of an instruction. In emulation mode M and X are both set.
+	static constexpr unsigned int length(Byte opcode, bool m, bool x);
+
+	// The base cycles of an instruction given the M and X flags
+	static constexpr unsigned int cycles(Byte opcode, bool m, bool x)
+	{
+		return (((table[opcode].reads & F_X) ? x : m)
+			? table[opcode].cycles8 : table[opcode].cycles16);
+	}
+
+	// The base cycles of an instruction in emulation mode, where BRK and COP
+	// push and RTI pulls one byte less as there is no program bank
+	static constexpr unsigned int emulationCycles(Byte opcode)
+	{
+		return (cycles(opcode, true, true)
+			- (((opcode == 0x00) || (opcode == 0x02) || (opcode == 0x40)) ? 1 : 0));
+	}
+
+private:
+	op816();
+	~op816();
+};
+
+constexpr op816::Lengths op816::byLength[4] = {
+	op816::lengths(false, false), op816::lengths(false, true),
+	op816::lengths(true, false), op816::lengths(true, true)
+};
+
+constexpr unsigned int op816::length(Byte opcode, bool m, bool x)
+{
+	return (byLength[(m ? 2 : 0) + (x ? 1 : 0)].bytes[opcode]);
+}
+
+static_assert(op816::length(0xa9, true, true) == 2, "8-bit LDA #");
+static_assert(op816::length(0xa9, false, true) == 3, "16-bit LDA #");
+static_assert(op816::length(0x5c, true, true) == 4, "JMP >a");
+#endif
\ No newline at end of file
@@ -0,0 +1,190 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <iostream>
+
+using namespace std;
+
+#ifdef __linux__
+# include <linux/perf_event.h>
+# include <string.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+#include "perf816.h"
+
+//==============================================================================
+
+// The names used when reporting each counter
+static const struct {
+	const char	   *name;
+	const char	   *label;
+} names[perf816::COUNTERS] = {
+	{ "hostCycles",			"Host cycles" },
+	{ "hostInstructions",	"Host instructions" },
+	{ "branchMisses",		"Branch misses" },
+	{ "l1dMisses",			"L1D misses" },
+	{ "llcMisses",			"LLC misses" }
+};
+
+// Construct with every counter closed
+perf816::perf816()
+{
+	for (int counter = 0; counter < COUNTERS; ++counter)
+		fds[counter] = -1;
+}
+
+// Close any counters that were opened
+perf816::~perf816()
+{
+#ifdef __linux__
+	for (int counter = 0; counter < COUNTERS; ++counter)
+		if (fds[counter] >= 0) close(fds[counter]);
+#endif
+}
+
+//==============================================================================
+
+#ifdef __linux__
+// Open one user space counter for the calling thread in a disabled state
+static int openCounter(__u32 type, __u64 config)
+{
+	perf_event_attr	attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return ((int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+// Try to open each of the counters
+bool perf816::open()
+{
+	bool	opened = false;
+
+#ifdef __linux__
+	static const struct {
+		__u32	type;
+		__u64	config;
+	} events[COUNTERS] = {
+		{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_HW_CACHE,	PERF_COUNT_HW_CACHE_L1D
+			| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+		{ PERF_TYPE_HW_CACHE,	PERF_COUNT_HW_CACHE_LL
+			| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+			| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+	};
+
+	for (int counter = 0; counter < COUNTERS; ++counter) {
+		if (fds[counter] < 0)
+			fds[counter] = openCounter(events[counter].type, events[counter].config);
+		if (fds[counter] >= 0) opened = true;
+	}
+#endif
+	return (opened);
+}
+
+// Let the open counters run
+void perf816::start()
+{
+#ifdef __linux__
+	for (int counter = 0; counter < COUNTERS; ++counter)
+		if (fds[counter] >= 0) ioctl(fds[counter], PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+// Pause the open counters, keeping their totals
+void perf816::stop()
+{
+#ifdef __linux__
+	for (int counter = 0; counter < COUNTERS; ++counter)
+		if (fds[counter] >= 0) ioctl(fds[counter], PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+// Read a counter's total. If the kernel shared the hardware between several
+// counters the value is scaled by the fraction of the time it was counting.
+double perf816::getCount(Counter counter) const
+{
+#ifdef __linux__
+	__u64	values[3];
+
+	if ((fds[counter] >= 0)
+			&& (read(fds[counter], values, sizeof(values)) == sizeof(values))) {
+		if ((values[2] > 0) && (values[2] < values[1]))
+			return ((double) values[0] * values[1] / values[2]);
+		return ((double) values[0]);
+	}
+#endif
+	return (0);
+}
+
+//==============================================================================
+// Reporting
+//------------------------------------------------------------------------------
+
+// Write each counter divided by the emulated instructions along with the
+// host's IPC when both cycles and instructions were counted.
+void perf816::report(ostream &out, unsigned long instructions) const
+{
+	out << endl << "Host counters per emulated instruction:" << endl;
+	for (int counter = 0; counter < COUNTERS; ++counter) {
+		out << "  " << names[counter].label << ": ";
+		if (isAvailable((Counter) counter) && instructions)
+			out << getCount((Counter) counter) / instructions;
+		else
+			out << "unavailable";
+		out << endl;
+	}
+
+	if (isAvailable(CYCLES) && isAvailable(INSTRUCTIONS)) {
+		double	cycles = getCount(CYCLES);
+
+		if (cycles > 0)
+			out << "  Host IPC: " << getCount(INSTRUCTIONS) / cycles << endl;
+	}
+}
+
+// Write the same figures as a JSON object, using null for missing counters
+void perf816::reportJSON(ostream &out, unsigned long instructions) const
+{
+	out << "{\"instructions\":" << instructions;
+	for (int counter = 0; counter < COUNTERS; ++counter) {
+		out << ",\"" << names[counter].name << "\":";
+		if (isAvailable((Counter) counter))
+			out << (unsigned long long)(getCount((Counter) counter) + 0.5);
+		else
+			out << "null";
+	}
+	out << '}' << endl;
+}
\ No newline at end of file
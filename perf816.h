@@ -0,0 +1,75 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef PERF816_H
+#define PERF816_H
+
+#include <iostream>
+
+#include "wdc816.h"
+
+// The perf816 class reads the host's hardware performance counters around
+// runs of the emulator so that host IPC, branch mispredictions and cache
+// misses can be set against the emulated instructions executed. Counters are
+// only available through perf_event_open on Linux; elsewhere, or when the
+// kernel refuses access, the affected counters are simply reported as
+// unavailable.
+
+class perf816 :
+	public wdc816
+{
+public:
+	// The counters that are collected
+	enum Counter {
+		CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES,
+		COUNTERS
+	};
+
+	perf816();
+	~perf816();
+
+	// Open the counters for the calling thread. Returns false if none of them
+	// could be opened.
+	bool open();
+
+	// Count between a start and a stop, accumulating across runs
+	void start();
+	void stop();
+
+	// Test if a counter was opened
+	bool isAvailable(Counter counter) const
+	{
+		return (fds[counter] >= 0);
+	}
+
+	// The total for a counter, scaled up if the kernel had to multiplex it
+	double getCount(Counter counter) const;
+
+	// Write the counts per emulated instruction as text or as a JSON object
+	void report(std::ostream &out, unsigned long instructions) const;
+	void reportJSON(std::ostream &out, unsigned long instructions) const;
+
+private:
+	int		fds[COUNTERS];
+
+	perf816(const perf816 &);
+};
+#endif
\ No newline at end of file
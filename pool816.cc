@@ -0,0 +1,148 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include "pool816.h"
+
+thread_local pool816   *pool816::owner = NULL;
+thread_local int		pool816::index = -1;
+
+//==============================================================================
+
+// Start the worker threads. A count of zero sizes the pool to the host cores.
+pool816::pool816(unsigned int threads)
+	: queued(0), pending(0), next(0), closing(false)
+{
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+
+	for (unsigned int index = 0; index < threads; ++index)
+		workers.push_back(new Worker);
+
+	for (unsigned int index = 0; index < threads; ++index)
+		workers[index]->thread = std::thread(&pool816::run, this, index);
+}
+
+// Stop the workers once the queues have drained
+pool816::~pool816()
+{
+	wait();
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		closing = true;
+	}
+	ready.notify_all();
+
+	// Other workers may still probe a queue until they have all stopped
+	for (unsigned int index = 0; index < workers.size(); ++index)
+		workers[index]->thread.join();
+	for (unsigned int index = 0; index < workers.size(); ++index)
+		delete workers[index];
+}
+
+// Queue a task for execution
+void pool816::submit(Task task)
+{
+	unsigned int target = (owner == this) ? index
+		: (next++ % (unsigned int) workers.size());
+
+	++pending;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		++queued;
+	}
+	{
+		std::lock_guard<std::mutex> guard(workers[target]->lock);
+		workers[target]->tasks.push_back(std::move(task));
+	}
+	ready.notify_one();
+}
+
+// Wait for all the queued and running tasks to complete
+void pool816::wait()
+{
+	std::unique_lock<std::mutex> guard(lock);
+
+	done.wait(guard, [this] { return (pending == 0); });
+}
+
+// Return the index of the calling worker
+int pool816::worker()
+{
+	return (index);
+}
+
+//==============================================================================
+
+// Take the oldest task from our own queue or steal the newest from another
+bool pool816::take(unsigned int self, Task &task)
+{
+	{
+		Worker &mine = *workers[self];
+		std::lock_guard<std::mutex> guard(mine.lock);
+
+		if (!mine.tasks.empty()) {
+			task = std::move(mine.tasks.front());
+			mine.tasks.pop_front();
+			--queued;
+			return (true);
+		}
+	}
+
+	for (unsigned int count = 1; count < workers.size(); ++count) {
+		Worker &victim = *workers[(self + count) % workers.size()];
+		std::lock_guard<std::mutex> guard(victim.lock);
+
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.back());
+			victim.tasks.pop_back();
+			--queued;
+			return (true);
+		}
+	}
+	return (false);
+}
+
+// The main loop of a worker thread
+void pool816::run(unsigned int self)
+{
+	owner = this;
+	index = self;
+
+	for (;;) {
+		Task	task;
+
+		if (take(self, task)) {
+			task();
+
+			if (--pending == 0) {
+				std::lock_guard<std::mutex> guard(lock);
+				done.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(lock);
+		ready.wait(guard, [this] { return (closing || (queued > 0)); });
+		if (closing && (queued == 0)) break;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef POOL816_H
+#define POOL816_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "wdc816.h"
+
+// The pool816 class is a work-stealing thread pool. Each worker owns a queue
+// of tasks which it services in order from the front, and idle workers steal
+// from the back of the other queues. Serving in order keeps tasks that requeue
+// themselves (like scheduler time slices) fair. As the emulator state is held
+// per thread each worker hosts exactly one emulator at a time.
+
+class pool816
+{
+public:
+	typedef std::function<void()> Task;
+
+	pool816(unsigned int threads = 0);
+	~pool816();
+
+	// Queue a task, on the caller's own queue if it is one of our workers
+	void submit(Task task);
+
+	// Wait until every submitted task has completed
+	void wait();
+
+	// The number of worker threads
+	INLINE unsigned int size() const
+	{
+		return ((unsigned int) workers.size());
+	}
+
+	// The index of the calling worker or -1 if called from another thread
+	static int worker();
+
+private:
+	struct Worker {
+		std::mutex			lock;
+		std::deque<Task>	tasks;
+		std::thread			thread;
+	};
+
+	std::vector<Worker *>	workers;
+
+	std::mutex				lock;			// Guards sleeping and completion
+	std::condition_variable	ready;			// Signalled when work is queued
+	std::condition_variable	done;			// Signalled when work completes
+
+	std::atomic<unsigned long> queued;		// Tasks waiting in the queues
+	std::atomic<unsigned long> pending;		// Tasks queued or running
+	std::atomic<unsigned int>  next;		// Round robin for external submits
+	bool					closing;
+
+	static thread_local pool816 *owner;
+	static thread_local int		index;
+
+	bool take(unsigned int self, Task &task);
+	void run(unsigned int self);
+};
+#endif
\ No newline at end of file
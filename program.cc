@@ -21,19 +21,30 @@
 
 #include <iostream>
 #include <fstream>
+#include <set>
 #include <string>
+#include <vector>
 
 using namespace std;
 
 #include <string.h>
 
-#if defined(_WIN32) || defined (_WIN64)
-#include "Windows.h"
-#else
-#include <time.h>
-#endif
-
+#include "batch816.h"
+#include "bench816.h"
+#include "check816.h"
+#include "dis816.h"
 #include "emu816.h"
+#include "fuzz816.h"
+#include "gdb816.h"
+#include "journal816.h"
+#include "load816.h"
+#include "perf816.h"
+#include "region816.h"
+#include "sched816.h"
+#include "stats816.h"
+#include "throttle816.h"
+#include "timer816.h"
+#include "trace816.h"
 
 //==============================================================================
 // Memory Definitions
@@ -45,6 +56,63 @@ using namespace std;
 
 bool trace = false;
 
+// Give the guest a sparse 16M address space instead
+bool sparse = false;
+emu816::Space space;
+
+// Back guest memory with huge pages
+bool huge = false;
+
+// Batch mode settings
+char *manifest = NULL;
+const char *results = "results.json";
+unsigned int threads = 0;
+unsigned long limit = 0;
+
+// Time-sliced scheduler settings
+char *guests = NULL;
+unsigned long quantum = 0;
+double tickInterval = 0;
+
+// Real-time throttle setting
+double mhz = 0;
+
+// Disassembly range, trace history length and trace files
+char *listing = NULL;
+unsigned long history = 0;
+char *traceFile = NULL;
+bool traceDrop = false;
+char *printFile = NULL;
+
+// Record/replay journal
+char *recording = NULL;
+char *playback = NULL;
+
+// Benchmark settings
+char *benchFile = NULL;
+char *microFile = NULL;
+char *baseline = NULL;
+char *report = NULL;
+bool counters = false;
+char *heatFile = NULL;
+char *statsTarget = NULL;
+double statsInterval = 1.0;
+
+// Breakpoints and watchpoints
+set<wdc816::Addr> breakpoints;
+vector<mem816::Watch> watches;
+char *gdbTarget = NULL;
+bool verify = false;
+unsigned int repeats = 0;
+unsigned int warmups = 1;
+
+// Fuzzing settings
+char *seeds = NULL;
+const char *findings = "findings";
+char *buffer = NULL;
+char *entry = NULL;
+unsigned long execs = 0;
+
 //==============================================================================
 
 // Initialise the emulator
@@ -59,79 +127,40 @@ INLINE void loop()
 	emu816::step();
 }
 
-//==============================================================================
-// S19/28 Record Loader
-//------------------------------------------------------------------------------
-
-unsigned int toNybble(char ch)
+// Report a breakpoint that stopped the guest and let it carry on. Returns
+// false if the guest stopped for any other reason.
+bool resumeBreak()
 {
-	if ((ch >= '0') && (ch <= '9')) return (ch - '0');
-	if ((ch >= 'A') && (ch <= 'F')) return (ch - 'A' + 10);
-	if ((ch >= 'a') && (ch <= 'f')) return (ch - 'a' + 10);
-	return (0);
-}
+	if (emu816::getBreak() == emu816::NO_BREAK) return (false);
 
-unsigned int toByte(string &str, int &offset)
-{
-	unsigned int	h = toNybble(str[offset++]) << 4;
-	unsigned int	l = toNybble(str[offset++]);
-
-	return (h | l);
+	cout << endl << ">> Breakpoint at " << wdc816::toHex(emu816::getBreak(), 6)
+		<< " after " << emu816::getInstructions() << " instructions, "
+		<< emu816::getCycles() << " cycles" << endl;
+	emu816::resume();
+	return (true);
 }
 
-unsigned int toWord(string &str, int &offset)
+// Report an access to a watched range of memory
+void reportWatch(wdc816::Addr ea, wdc816::Byte before, wdc816::Byte after, bool write)
 {
-	unsigned int	h = toByte(str, offset) << 8;
-	unsigned int	l = toByte(str, offset);
-
-	return (h | l);
+	cout << endl << ">> Watch " << (write ? "write" : "read") << " at "
+		<< wdc816::toHex(ea, 6) << ", PC " << wdc816::toHex(emu816::getInstPC(), 6)
+		<< ", " << wdc816::toHex(before, 2);
+	if (write)
+		cout << " -> " << wdc816::toHex(after, 2);
+	cout << ", cycle " << emu816::getCycles() << endl;
 }
 
-unsigned long toAddr(string &str, int &offset)
-{
-	unsigned long	h = toByte(str, offset) << 16;
-	unsigned long	m = toByte(str, offset) << 8;
-	unsigned long	l = toByte(str, offset);
-
-	return (h | m | l);
-}
+//==============================================================================
+// S19/28 Record Loader
+//------------------------------------------------------------------------------
 
 void load(char *filename)
 {
-	ifstream	file(filename);
-	string	line;
-
-	if (file.is_open()) {
+	if (load816::load(filename))
 		cout << ">> Loading S28: " << filename << endl;
-
-		while (!file.eof()) {
-			file >> line;
-			if (line[0] == 'S') {
-				int offset = 2;
-
-				if (line[1] == '1') {
-					unsigned int count = toByte(line, offset);
-					unsigned long addr = toWord(line, offset);
-					count -= 3;
-					while (count-- > 0) {
-						emu816::setByte(addr++, toByte(line, offset));
-					}
-				}
-				else if (line[1] == '2') {
-					unsigned int count = toByte(line, offset);
-					unsigned long addr = toAddr(line, offset);
-					count -= 4;
-					while (count-- > 0) {
-						emu816::setByte(addr++, toByte(line, offset));
-					}
-				}
-			}
-		}
-		file.close();
-	}
 	else
 		cerr << "Failed to open file" << endl;
-
 }
 
 //==============================================================================
@@ -142,8 +171,6 @@ int main(int argc, char **argv)
 {
 	int	index = 1;
 
-	setup();
-
 	while (index < argc) {
 		if (argv[index][0] != '-') break;
 
@@ -153,8 +180,255 @@ int main(int argc, char **argv)
 			continue;
 		}
 
+		if (!strcmp(argv[index], "-d") && (index + 1 < argc)) {
+			listing = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-h") && (index + 1 < argc)) {
+			history = strtoul(argv[index + 1], NULL, 10);
+			index += 2;
+			continue;
+		}
+
+		if ((!strcmp(argv[index], "-T") || !strcmp(argv[index], "-Td"))
+				&& (index + 1 < argc)) {
+			traceFile = argv[index + 1];
+			traceDrop = (argv[index][2] == 'd');
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-P") && (index + 1 < argc)) {
+			printFile = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-H")) {
+			huge = true;
+			++index;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-m")) {
+			sparse = true;
+			++index;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-n")) {
+			emu816::setFusion(false);
+			++index;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-B") && (index + 1 < argc)) {
+			benchFile = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-M") && (index + 1 < argc)) {
+			microFile = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-C") && (index + 1 < argc)) {
+			baseline = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-R") && (index + 1 < argc)) {
+			repeats = strtoul(argv[index + 1], NULL, 10);
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-J") && (index + 1 < argc)) {
+			report = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-A") && (index + 1 < argc)) {
+			heatFile = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-S") && (index + 1 < argc)) {
+			statsTarget = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-Si") && (index + 1 < argc)) {
+			statsInterval = strtod(argv[index + 1], NULL);
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-k") && (index + 1 < argc)) {
+			char   *next = argv[index + 1];
+
+			do {
+				breakpoints.insert(strtoul(next, &next, 16) & 0xffffff);
+			} while (*next++ == ',');
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-w") && (index + 1 < argc)) {
+			char		   *next = argv[index + 1];
+			mem816::Watch	watch;
+
+			watch.start = strtoul(next, &next, 16) & 0xffffff;
+			watch.end = (*next == '-') ? strtoul(next + 1, &next, 16) & 0xffffff : watch.start;
+			watch.kinds = 0;
+			if (*next++ == ':')
+				for (; *next; ++next) {
+					if (*next == 'r') watch.kinds |= mem816::WATCH_READ;
+					if (*next == 'w') watch.kinds |= mem816::WATCH_WRITE;
+				}
+			if (!watch.kinds) watch.kinds = mem816::WATCH_WRITE;
+			watches.push_back(watch);
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-g") && (index + 1 < argc)) {
+			gdbTarget = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-V")) {
+			verify = true;
+			++index;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-E")) {
+			counters = true;
+			++index;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-W") && (index + 1 < argc)) {
+			warmups = strtoul(argv[index + 1], NULL, 10);
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-b") && (index + 1 < argc)) {
+			manifest = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-o") && (index + 1 < argc)) {
+			results = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-j") && (index + 1 < argc)) {
+			threads = strtoul(argv[index + 1], NULL, 10);
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-l") && (index + 1 < argc)) {
+			limit = strtoul(argv[index + 1], NULL, 10);
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-s") && (index + 1 < argc)) {
+			guests = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-si") && (index + 1 < argc)) {
+			tickInterval = strtod(argv[index + 1], NULL);
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-q") && (index + 1 < argc)) {
+			quantum = strtoul(argv[index + 1], NULL, 10);
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-f") && (index + 1 < argc)) {
+			mhz = strtod(argv[index + 1], NULL);
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-r") && (index + 1 < argc)) {
+			recording = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-p") && (index + 1 < argc)) {
+			playback = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-z") && (index + 1 < argc)) {
+			seeds = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-zo") && (index + 1 < argc)) {
+			findings = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-zb") && (index + 1 < argc)) {
+			buffer = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-ze") && (index + 1 < argc)) {
+			entry = argv[index + 1];
+			index += 2;
+			continue;
+		}
+
+		if (!strcmp(argv[index], "-zn") && (index + 1 < argc)) {
+			execs = strtoul(argv[index + 1], NULL, 10);
+			index += 2;
+			continue;
+		}
+
 		if (!strcmp(argv[index], "-?")) {
-			cerr << "Usage: emu816 [-t] s19/28-file ..." << endl;
+			cerr << "Usage: emu816 [-t] [-n] [-m] [-H] [-f MHz [-q cycles]] [-r|-p journal] s19/28-file ..." << endl;
+			cerr << "       emu816 [-R repeats] [-J report] [-E] [-A heatmap] ... s19/28-file ..." << endl;
+			cerr << "       emu816 [-S file|unix:path|- [-Si secs]] ... s19/28-file ..." << endl;
+			cerr << "       emu816 [-k addr[,addr...]] [-w start[-end][:rw]] ... s19/28-file ..." << endl;
+			cerr << "       emu816 -g port|unix:path [-q cycles] ... s19/28-file ..." << endl;
+			cerr << "       emu816 [-h count | -T[d] trace-file] ... s19/28-file ..." << endl;
+			cerr << "       emu816 -d start:end s19/28-file ..." << endl;
+			cerr << "       emu816 -P trace-file" << endl;
+			cerr << "       emu816 -V" << endl;
+			cerr << "       emu816 -B|-M results [-C baseline] [-R repeats] [-W warmups] [-l cycles]" << endl;
+			cerr << "       emu816 -b manifest [-m] [-H] [-o results] [-j threads] [-l cycles]" << endl;
+			cerr << "       emu816 -s manifest [-m] [-H] [-j threads] [-q cycles] [-si secs] [-l cycles]" << endl;
+			cerr << "       emu816 -z seeds [-zo dir] [-zb addr:size] [-ze addr] [-zn execs]" << endl;
+			cerr << "              [-l cycles] s19/28-file ..." << endl;
 			return (1);
 		}
 
@@ -162,6 +436,130 @@ int main(int argc, char **argv)
 		return (1);
 	}
 
+	if (printFile) {
+		if (!trace816::renderFile(printFile, cout)) {
+			cerr << "Failed to read trace file" << endl;
+			return (1);
+		}
+		return (0);
+	}
+
+	emu816::setHugePages(huge);
+	setup();
+	if (sparse)
+		emu816::setMemory(&space);
+
+	if (verify) {
+		unsigned long	failures = check816::decimal(cout);
+
+		failures += check816::opcodes(cout);
+		return (failures ? 2 : 0);
+	}
+
+	if (benchFile || microFile) {
+		int regressions = bench816::run(benchFile ? benchFile : microFile,
+			baseline, !benchFile, warmups, repeats ? repeats : 5,
+			limit ? limit : 1000000000L);
+
+		if (regressions < 0) {
+			cerr << "Failed to open benchmark files" << endl;
+			return (1);
+		}
+		return (regressions ? 2 : 0);
+	}
+
+	if (manifest) {
+		vector<batch816::Job>		jobs;
+		vector<batch816::Result>	output;
+
+		if (!batch816::readManifest(manifest, jobs, limit ? limit : 1000000000L)) {
+			cerr << "Failed to open manifest" << endl;
+			return (1);
+		}
+
+		batch816::run(jobs, output, threads, MEM_MASK,
+			sparse ? 0 : RAM_SIZE);
+
+		if (!batch816::writeResults(results, jobs, output)) {
+			cerr << "Failed to write results" << endl;
+			return (1);
+		}
+		return (0);
+	}
+
+	if (guests) {
+		vector<batch816::Job>	jobs;
+
+		if (!batch816::readManifest(guests, jobs, limit ? limit : 1000000000L)) {
+			cerr << "Failed to open manifest" << endl;
+			return (1);
+		}
+
+		sched816	sched(threads, quantum ? quantum : 100000L, tickInterval);
+
+		for (size_t job = 0; job < jobs.size(); ++job)
+			sched.add(jobs[job].image.c_str(), jobs[job].input.c_str(),
+				jobs[job].limit, MEM_MASK, sparse ? 0 : RAM_SIZE);
+
+		sched.run();
+
+		for (unsigned int id = 0; id < sched.size(); ++id) {
+			sched816::Stats	stats;
+
+			sched.stats(id, stats);
+			cout << "Guest " << id << " " << jobs[id].image << ": " << stats.status;
+			cout << ", " << stats.cycles << " cycles in " << stats.quanta << " quanta";
+			if (stats.busy > 0)
+				cout << ", " << stats.cycles / stats.busy / 1000000.0 << " MHz running";
+			if (stats.elapsed > 0)
+				cout << ", " << stats.cycles / stats.elapsed / 1000000.0 << " MHz overall";
+			if (stats.quanta > 0)
+				cout << ", latency avg " << stats.latency / stats.quanta * 1000000.0
+					<< " us max " << stats.maxLatency * 1000000.0 << " us";
+			cout << endl;
+		}
+		return (0);
+	}
+
+	if (seeds) {
+		fuzz816			fuzz(MEM_MASK, RAM_SIZE, limit ? limit : 1000000L);
+		vector<string>	images(argv + index, argv + argc);
+
+		if (buffer) {
+			char		   *size;
+			unsigned long	addr = strtoul(buffer, &size, 16);
+
+			fuzz.setBuffer(addr, (*size == ':') ? strtoul(size + 1, NULL, 10) : 256);
+		}
+		if (entry)
+			fuzz.setEntry(strtoul(entry, NULL, 16));
+
+		if (images.empty() || !fuzz.boot(images)) {
+			cerr << "Failed to boot guest for fuzzing" << endl;
+			return (1);
+		}
+		if (!fuzz.addSeeds(seeds)) {
+			cerr << "Failed to read seeds" << endl;
+			return (1);
+		}
+		if (!fuzz.fuzz(execs, findings)) {
+			cerr << "Failed to write findings" << endl;
+			return (1);
+		}
+
+		const fuzz816::Stats &stats = fuzz.getStats();
+
+		cout << "Ran " << stats.execs << " inputs in " << stats.secs << " Secs";
+		if (stats.secs > 0)
+			cout << " (" << (unsigned long)(stats.execs / stats.secs) << "/sec)";
+		cout << endl << "Found " << stats.paths << " paths over " << stats.edges
+			<< " edges, " << stats.hangs << " hangs, " << stats.exits << " exits, "
+			<< stats.stops << " stops" << endl;
+		return (0);
+	}
+
+	int	images = index;
+
 	if (index < argc)
 		do {
 			load(argv[index++]);
@@ -171,47 +569,204 @@ int main(int argc, char **argv)
 		return (1);
 	}
 
-#ifdef	WIN32
-	LARGE_INTEGER freq, start, end;
+	if (listing) {
+		char   *end;
+		wdc816::Addr start = strtoul(listing, &end, 16);
+		bool	m = true;
+		bool	x = true;
 
-	QueryPerformanceFrequency(&freq);
-	QueryPerformanceCounter(&start);
+		dis816::list(start, (*end == ':') ? strtoul(end + 1, NULL, 16) : start + 64,
+			m, x, cout);
+		return (0);
+	}
 
-	cin.unsetf(ios_base::skipws);
-#else
-	timespec start, end;
+	journal816	journal;
+	trace816	recent(history ? history : 1);
 
-	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
-#endif
+	if (history)
+		emu816::setTrace(&recent);
 
-	emu816::reset(trace);
-	while (!emu816::isStopped ())
-		loop();
+	trace816   *stream = NULL;
 
-#ifdef	LINUX
-	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+	if (traceFile) {
+		stream = new trace816(traceFile, traceDrop);
+		if (!stream->isOpen()) {
+			cerr << "Failed to create trace file" << endl;
+			return (1);
+		}
+		emu816::setTrace(stream);
+	}
 
-	double secs = (end.tv_sec + end.tv_nsec / 1000000000.0)
-		    - (start.tv_sec + start.tv_nsec / 1000000000.0);
-#else
-	QueryPerformanceCounter(&end);
+	if (recording) {
+		if (!journal.record(recording)) {
+			cerr << "Failed to create journal" << endl;
+			return (1);
+		}
+		emu816::setJournal(&journal);
+	}
+	if (playback) {
+		if (!journal.replay(playback)) {
+			cerr << "Failed to read journal" << endl;
+			return (1);
+		}
+		emu816::setJournal(&journal);
+	}
 
-	double secs = (end.QuadPart - start.QuadPart) / (double) freq.QuadPart;
+#ifdef	WIN32
+	cin.unsetf(ios_base::skipws);
 #endif
 
-	double speed = emu816::getCycles() / secs;
+	// Only a plain run can be repeated as the others depend on outside state
+	unsigned int	runs = (playback || recording || traceFile || history || (mhz > 0) || gdbTarget)
+		? 1 : (repeats ? repeats : 1);
+	timer816		timer;
+	perf816			perf;
+	region816		regions;
+	unsigned long	retired = 0;
+
+	emu816::setRegions(&regions);
+	if (!breakpoints.empty())
+		emu816::setBreakpoints(&breakpoints);
+
+	// Fused instructions would be reported at the PC of the first one
+	if (!watches.empty()) {
+		emu816::setFusion(false);
+		emu816::setWatches(&watches, reportWatch);
+	}
 
-	cout << endl << "Executed " << emu816::getCycles() << " in " << secs << " Secs";
-	cout << endl << "Overall CPU Frequency = ";
-	if (speed < 1000.0)
-		cout << speed << " Hz";
-	else {
-		if ((speed /= 1000.0) < 1000.0)
-			cout << speed << " KHz";
+	mem816::Heatmap	   *heatmap = heatFile ? new mem816::Heatmap() : NULL;
+	stats816		   *live = NULL;
+
+	if (statsTarget) {
+		live = new stats816(statsTarget, statsInterval > 0 ? statsInterval : 1.0);
+		if (!live->start()) {
+			cerr << "Failed to open statistics target" << endl;
+			return (1);
+		}
+	}
+
+	// Fusion peeks ahead and retires whole loops, which would miscount fetches
+	if (heatmap) emu816::setFusion(false);
+	emu816::setHeatmap(heatmap);
+
+	gdb816		   *debugger = NULL;
+
+	if (gdbTarget) {
+		debugger = new gdb816(gdbTarget, quantum ? quantum : 100000L);
+		cout << ">> Waiting for GDB on " << gdbTarget << endl;
+		if (!debugger->open()) {
+			cerr << "Failed to open debugger target" << endl;
+			return (1);
+		}
+	}
+
+	if (counters && !perf.open()) {
+		cerr << "Host counters are unavailable" << endl;
+		counters = false;
+	}
+
+	for (unsigned int run = 0; run < runs; ++run) {
+		if (run) {
+			emu816::setHeatmap(NULL);
+			emu816::setWatches(NULL, NULL);
+			for (int image = images; image < argc; ++image)
+				load816::load(argv[image]);
+			emu816::setHeatmap(heatmap);
+			if (!watches.empty())
+				emu816::setWatches(&watches, reportWatch);
+		}
+
+		timer.start();
+		if (counters) perf.start();
+		emu816::reset(trace);
+		if (playback)
+			journal.play();
+		else if (mhz > 0) {
+			throttle816::Stats	stats;
+
+			throttle816::run(mhz * 1000000.0, quantum, stats);
+
+			cout << endl << "Throttled to " << mhz << " MHz in " << stats.quanta << " quanta";
+			cout << endl << "Slept " << stats.sleeps << " times, jitter avg "
+				<< stats.meanJitter * 1000000.0 << " us max " << stats.maxJitter * 1000000.0 << " us";
+			cout << endl << "Overran " << stats.overruns << " times, worst by "
+				<< stats.maxOverrun * 1000000.0 << " us";
+			cout << endl << "Final drift " << stats.drift * 1000000.0 << " us" << endl;
+		}
+		else if (debugger) {
+			if (debugger->serve())
+				while (!emu816::isStopped ())
+					loop();
+		}
+		else if (live)
+			do {
+				emu816::run(quantum ? quantum : 100000L);
+				live->publish();
+			} while (!emu816::isStopped() || resumeBreak());
+		else
+			do {
+				while (!emu816::isStopped ())
+					loop();
+			} while (resumeBreak());
+		if (counters) perf.stop();
+		timer.stop(emu816::getInstructions(), emu816::getCycles());
+		retired += emu816::getInstructions();
+	}
+
+	if (history) {
+		emu816::setTrace(NULL);
+		cout << endl << "Last " << recent.size() << " of " << recent.captured()
+			<< " instructions:" << endl;
+		recent.render(cout);
+	}
+
+	if (stream) {
+		emu816::setTrace(NULL);
+		if (!stream->close())
+			cerr << "Failed to write trace file" << endl;
+		cout << endl << "Traced " << stream->captured() - stream->dropped()
+			<< " instructions, dropped " << stream->dropped() << endl;
+		delete stream;
+	}
+
+	if (recording && !journal.close(emu816::getCycles()))
+		cerr << "Failed to write journal" << endl;
+	if (playback && journal.getDivergences())
+		cerr << "Replay diverged at " << journal.getDivergences() << " events" << endl;
+
+	emu816::setRegions(NULL);
+	emu816::setHeatmap(NULL);
+	emu816::setBreakpoints(NULL);
+	emu816::setWatches(NULL, NULL);
+	delete debugger;
+	delete live;
+
+	if (heatmap) {
+		ofstream	file(heatFile);
+
+		if (file.is_open())
+			heatmap->report(file);
+		else
+			cerr << "Failed to write heatmap" << endl;
+		delete heatmap;
+	}
+
+	timer.report(cout);
+	if (counters)
+		perf.report(cout, retired);
+	if (regions.size())
+		regions.report(cout);
+	if (report) {
+		ofstream	file(report);
+
+		if (file.is_open()) {
+			timer.reportJSON(file);
+			if (counters) perf.reportJSON(file, retired);
+			if (regions.size()) regions.reportJSON(file);
+		}
 		else
-			cout << (speed /= 1000.0) << " Mhz";
+			cerr << "Failed to write timing report" << endl;
 	}
-	cout << endl;
 
 	return(0);
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+
+using namespace std;
+
+#include "region816.h"
+#include "mem816.h"
+
+// The longest name read from guest memory
+#define MAX_NAME	64
+
+//==============================================================================
+
+// Construct an empty set of regions
+region816::region816()
+{ }
+
+// Destroy the regions
+region816::~region816()
+{ }
+
+//==============================================================================
+
+// Find a region, reading its name from guest memory the first time it is seen.
+// The name is peeked so that it is not counted or watched as a guest read.
+region816::Region &region816::find(Addr name)
+{
+	map<Addr, Region>::iterator	found = regions.find(name);
+
+	if (found != regions.end()) return (found->second);
+
+	Region &region = regions[name];
+	Byte	ch;
+
+	for (int index = 0; index < MAX_NAME; ++index) {
+		if ((ch = mem816::peekByte((name + index) & 0xffffff)) == 0) break;
+		region.name += (char) ch;
+	}
+
+	region.calls = 0;
+	region.unmatched = 0;
+	region.cycles = 0;
+	region.secs = 0;
+	region.depth = 0;
+	region.startCycles = 0;
+	return (region);
+}
+
+// Note the time at which the outermost start of a region occurs
+void region816::start(Addr name, unsigned long long cycles)
+{
+	Region &region = find(name);
+
+	if (region.depth++ == 0) {
+		region.startCycles = cycles;
+		region.startTime = chrono::steady_clock::now();
+	}
+}
+
+// Add the time since the matching start to the region's totals
+void region816::stop(Addr name, unsigned long long cycles)
+{
+	Region &region = find(name);
+
+	if (region.depth == 0) {
+		++region.unmatched;
+		return;
+	}
+
+	if (--region.depth == 0) {
+		region.cycles += cycles - region.startCycles;
+		region.secs += chrono::duration<double>(
+			chrono::steady_clock::now() - region.startTime).count();
+		++region.calls;
+	}
+}
+
+//==============================================================================
+// Reporting
+//------------------------------------------------------------------------------
+
+// Write a line for each region
+void region816::report(ostream &out) const
+{
+	out << endl << "Regions:" << endl;
+	for (map<Addr, Region>::const_iterator it = regions.begin(); it != regions.end(); ++it) {
+		const Region &region = it->second;
+
+		out << "  " << (region.name.empty() ? "?" : region.name) << ": "
+			<< region.calls << " calls, " << region.cycles << " cycles";
+		if (region.calls)
+			out << " (" << region.cycles / region.calls << " per call)";
+		out << ", " << region.secs << " Secs";
+		if (region.depth)
+			out << ", still open";
+		if (region.unmatched)
+			out << ", " << region.unmatched << " unmatched stops";
+		out << endl;
+	}
+}
+
+// Write the regions as a single JSON object
+void region816::reportJSON(ostream &out) const
+{
+	const char *separator = "";
+
+	out << "{\"regions\":[";
+	for (map<Addr, Region>::const_iterator it = regions.begin(); it != regions.end(); ++it) {
+		const Region &region = it->second;
+
+		out << separator << "{\"name\":\"";
+		for (size_t index = 0; index < region.name.size(); ++index) {
+			char	ch = region.name[index];
+
+			if ((ch == '"') || (ch == '\\'))
+				out << '\\' << ch;
+			else if ((ch >= ' ') && (ch <= '~'))
+				out << ch;
+		}
+		out << "\",\"address\":" << it->first;
+		out << ",\"calls\":" << region.calls;
+		out << ",\"cycles\":" << region.cycles;
+		out << ",\"secs\":" << region.secs;
+		out << ",\"open\":" << region.depth;
+		out << ",\"unmatched\":" << region.unmatched << '}';
+		separator = ",";
+	}
+	out << "]}" << endl;
+}
\ No newline at end of file
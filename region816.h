@@ -0,0 +1,76 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef REGION816_H
+#define REGION816_H
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "wdc816.h"
+
+// The region816 class collects timings for regions of guest code marked with
+// WDM #$10 (start) and WDM #$11 (stop). Each region is identified by the
+// address of a zero terminated name held in guest memory so that firmware can
+// time itself without a symbol file. Nested or recursive marks for the same
+// region are counted so that only the outermost pair is timed.
+
+class region816 :
+	public wdc816
+{
+public:
+	// The totals for a region
+	struct Region {
+		std::string		name;
+		unsigned long	calls;			// Completed start/stop pairs
+		unsigned long	unmatched;		// Stops without a start
+		unsigned long long cycles;		// Guest cycles inside the region
+		double			secs;			// Host time inside the region
+		unsigned int	depth;			// Open starts
+		unsigned long long startCycles;
+		std::chrono::steady_clock::time_point startTime;
+	};
+
+	region816();
+	~region816();
+
+	// Open or close the region whose name is at the given address
+	void start(Addr name, unsigned long long cycles);
+	void stop(Addr name, unsigned long long cycles);
+
+	// The number of regions seen
+	size_t size() const
+	{
+		return (regions.size());
+	}
+
+	// Write the totals as a table or as a JSON object
+	void report(std::ostream &out) const;
+	void reportJSON(std::ostream &out) const;
+
+private:
+	std::map<Addr, Region>	regions;
+
+	Region &find(Addr name);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,284 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+#include "sched816.h"
+#include "load816.h"
+
+//==============================================================================
+
+// Create a scheduler with the given number of workers (zero for one per core),
+// time slice length in cycles and timer interval in seconds.
+sched816::sched816(unsigned int threads, unsigned long quantum, double interval)
+	: pool(threads), quantum(quantum), interval(interval), active(0)
+{ }
+
+// Release the guests once the workers are idle
+sched816::~sched816()
+{
+	pool.wait();
+
+	for (size_t index = 0; index < guests.size(); ++index) {
+		delete guests[index]->space;
+		delete guests[index];
+	}
+}
+
+// Point this thread's emulator at a guest's memory
+void sched816::attach(Guest *guest)
+{
+	if (guest->space)
+		emu816::setMemory(guest->space);
+	else
+		emu816::setMemory(guest->memMask, guest->ramSize, guest->ram.data(),
+			NULL);
+}
+
+// Load a guest into its own memory and reset it. The guest does not run until
+// run() is called.
+unsigned int sched816::add(const char *image, const char *input,
+	unsigned long limit, Addr memMask, Addr ramSize)
+{
+	Guest *guest = new Guest;
+
+	guest->mode = PARKED;
+	guest->wakeup = false;
+	guest->limit = limit;
+	guest->memMask = memMask;
+	guest->ramSize = ramSize;
+	guest->ram.assign(ramSize, 0);
+	guest->space = ramSize ? NULL : new emu816::Space;
+	guest->added = Clock::now();
+	guest->quanta = 0;
+	guest->busy = 0;
+	guest->latency = 0;
+	guest->maxLatency = 0;
+
+	if (input && *input) {
+		ifstream	file(input, ios::binary);
+
+		if (file.is_open()) {
+			ostringstream data;
+
+			data << file.rdbuf();
+			guest->in.str(data.str());
+		}
+	}
+
+	// Use this thread's emulator to build the initial state
+	attach(guest);
+	guest->failed = !load816::load(image);
+	emu816::reset(false);
+	emu816::save(guest->cpu);
+
+	if (guest->failed) {
+		guest->mode = STOPPED;
+		guest->finished = guest->added;
+	}
+
+	guests.push_back(guest);
+	return ((unsigned int)(guests.size() - 1));
+}
+
+// Deliver an interrupt. A parked guest is requeued immediately while a running
+// one is released at the end of its current time slice.
+void sched816::wake(unsigned int id)
+{
+	Guest *guest = guests[id];
+	std::lock_guard<std::mutex> guard(guest->lock);
+
+	switch (guest->mode) {
+	case PARKED:
+		guest->cpu.interrupted = true;
+		guest->cpu.waiting = false;
+		++guest->cpu.interrupts;
+		queue(guest);
+		break;
+
+	case QUEUED:
+	case RUNNING:
+		guest->wakeup = true;
+		break;
+
+	case STOPPED:
+		break;
+	}
+}
+
+// Start every parked guest and wait until none are queued or running. With a
+// timer every guest is interrupted each interval until they have all stopped,
+// so a guest parked in WAI or STP is woken by the next tick.
+void sched816::run()
+{
+	for (size_t index = 0; index < guests.size(); ++index) {
+		Guest *guest = guests[index];
+		std::lock_guard<std::mutex> guard(guest->lock);
+
+		if ((guest->mode == PARKED) && !guest->cpu.waiting)
+			queue(guest);
+	}
+
+	if (interval > 0) {
+		do
+			this_thread::sleep_for(chrono::duration<double>(interval));
+		while (tick());
+	}
+
+	std::unique_lock<std::mutex> guard(lock);
+	idle.wait(guard, [this] { return (active == 0); });
+}
+
+// Return a guest's statistics
+void sched816::stats(unsigned int id, Stats &stats)
+{
+	Guest *guest = guests[id];
+	std::lock_guard<std::mutex> guard(guest->lock);
+	Clock::time_point end = (guest->mode == STOPPED) ? guest->finished : Clock::now();
+
+	if (guest->failed)
+		stats.status = "error";
+	else if (guest->mode == STOPPED)
+		stats.status = guest->cpu.stopped ? "stopped" : "limit";
+	else if (guest->mode == PARKED)
+		stats.status = "parked";
+	else
+		stats.status = "running";
+
+	stats.cycles = guest->cpu.cycles;
+	stats.quanta = guest->quanta;
+	stats.busy = guest->busy;
+	stats.elapsed = chrono::duration<double>(end - guest->added).count();
+	stats.latency = guest->latency;
+	stats.maxLatency = guest->maxLatency;
+}
+
+// Return the console output of a guest
+string sched816::output(unsigned int id)
+{
+	Guest *guest = guests[id];
+	std::lock_guard<std::mutex> guard(guest->lock);
+
+	return (guest->out.str());
+}
+
+//==============================================================================
+
+// Make a guest runnable. Called with the guest lock held.
+void sched816::queue(Guest *guest)
+{
+	if (guest->mode == PARKED) {
+		std::lock_guard<std::mutex> guard(lock);
+		++active;
+	}
+
+	guest->mode = QUEUED;
+	guest->queued = Clock::now();
+	pool.submit([=] { slice(guest); });
+}
+
+// Run one time slice of a guest on the calling worker
+void sched816::slice(Guest *guest)
+{
+	Clock::time_point start = Clock::now();
+	double	wait = chrono::duration<double>(start - guest->queued).count();
+
+	{
+		std::lock_guard<std::mutex> guard(guest->lock);
+
+		guest->mode = RUNNING;
+		guest->latency += wait;
+		if (wait > guest->maxLatency) guest->maxLatency = wait;
+	}
+
+	unsigned long budget = quantum;
+
+	if (guest->limit - guest->cpu.cycles < budget)
+		budget = guest->limit - guest->cpu.cycles;
+
+	attach(guest);
+	emu816::setConsole(&guest->in, &guest->out);
+	emu816::restore(guest->cpu);
+	emu816::run(budget);
+
+	Clock::time_point end = Clock::now();
+	std::lock_guard<std::mutex> guard(guest->lock);
+
+	emu816::save(guest->cpu);
+	emu816::setConsole(&cin, &cout);
+
+	guest->busy += chrono::duration<double>(end - start).count();
+	++guest->quanta;
+
+	if (guest->cpu.stopped || (guest->cpu.cycles >= guest->limit)) {
+		guest->mode = STOPPED;
+		guest->finished = end;
+		retire();
+	}
+	else if (guest->cpu.waiting && !guest->wakeup) {
+		guest->mode = PARKED;
+		retire();
+	}
+	else {
+		if (guest->wakeup) {
+			guest->wakeup = false;
+			guest->cpu.interrupted = true;
+			guest->cpu.waiting = false;
+			++guest->cpu.interrupts;
+		}
+		guest->mode = QUEUED;
+		guest->queued = end;
+		pool.submit([=] { slice(guest); });
+	}
+}
+
+// Note that a guest has left the queues
+void sched816::retire()
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (--active == 0)
+		idle.notify_all();
+}
+
+// Deliver a timer interrupt to every guest that has not stopped. Returns false
+// once they all have.
+bool sched816::tick()
+{
+	bool	alive = false;
+
+	for (unsigned int id = 0; id < guests.size(); ++id) {
+		{
+			std::lock_guard<std::mutex> guard(guests[id]->lock);
+
+			if (guests[id]->mode == STOPPED) continue;
+		}
+		wake(id);
+		alive = true;
+	}
+	return (alive);
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef SCHED816_H
+#define SCHED816_H
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "pool816.h"
+#include "emu816.h"
+
+// The sched816 class multiplexes many long-running guests onto a pool of
+// worker threads. Each guest is run for a quantum of cycles at a time and then
+// requeued, so all guests make fair progress. Guests that park themselves in
+// a WAI or STP are held off the queues until woken by an interrupt, either
+// from wake() or from a timer that ticks every guest at a fixed interval.
+
+class sched816 :
+	public wdc816
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// The scheduling statistics for a guest
+	struct Stats {
+		const char	   *status;			// "stopped", "limit", "parked" or "error"
+		unsigned long long cycles;		// Cycles executed
+		unsigned long	quanta;			// Number of time slices run
+		double			busy;			// Seconds spent executing
+		double			elapsed;		// Seconds since the guest was added
+		double			latency;		// Total seconds spent runnable but queued
+		double			maxLatency;		// Worst wait for a time slice
+	};
+
+	// Create a scheduler, giving the seconds between timer interrupts or zero
+	// for none
+	sched816(unsigned int threads, unsigned long quantum, double interval = 0);
+	~sched816();
+
+	// Add a guest, returning its identifier. A ramSize of zero gives the guest
+	// a sparse 16M address space.
+	unsigned int add(const char *image, const char *input, unsigned long limit,
+		Addr memMask, Addr ramSize);
+
+	// Deliver an interrupt to a guest, waking it if parked
+	void wake(unsigned int id);
+
+	// Run until every guest has stopped or, without a timer, is parked
+	void run();
+
+	// Retrieve the statistics and console output of a guest
+	void stats(unsigned int id, Stats &stats);
+	std::string output(unsigned int id);
+
+	// The number of guests
+	INLINE unsigned int size() const
+	{
+		return ((unsigned int) guests.size());
+	}
+
+private:
+	enum Mode { QUEUED, RUNNING, PARKED, STOPPED };
+
+	struct Guest {
+		std::mutex			lock;
+		Mode				mode;
+		bool				wakeup;		// Interrupt arrived while running
+		bool				failed;		// Image could not be loaded
+		unsigned long		limit;
+
+		emu816::State		cpu;
+		Addr				memMask;
+		Addr				ramSize;
+		emu816::RAM			ram;
+		emu816::Space	   *space;		// Sparse memory or NULL
+		std::istringstream	in;
+		std::ostringstream	out;
+
+		Clock::time_point	added;
+		Clock::time_point	queued;
+		Clock::time_point	finished;
+		unsigned long		quanta;
+		double				busy;
+		double				latency;
+		double				maxLatency;
+	};
+
+	pool816					pool;
+	unsigned long			quantum;
+	double					interval;	// Seconds between timer ticks
+	std::vector<Guest *>	guests;
+
+	std::mutex				lock;		// Guards active and idle
+	std::condition_variable	idle;
+	unsigned long			active;		// Guests queued or running
+
+	static void attach(Guest *guest);
+	void queue(Guest *guest);
+	void slice(Guest *guest);
+	void retire();
+	bool tick();
+};
+#endif
\ No newline at end of file
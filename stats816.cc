@@ -0,0 +1,296 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+# include <fcntl.h>
+# include <signal.h>
+# include <string.h>
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL	0
+#endif
+
+#include "stats816.h"
+#include "emu816.h"
+
+// How often the monitor looks for signals and clients
+#define POLL_MS		50
+
+// Set by the SIGUSR1 handler
+static volatile sig_atomic_t	requested = 0;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// Note a request for a snapshot
+static void onSignal(int)
+{
+	requested = 1;
+}
+#endif
+
+//==============================================================================
+
+// Construct an idle monitor
+stats816::stats816(const char *target, double interval)
+	: sequence(0), target(target), interval(interval), listener(-1),
+	  running(false)
+{
+	for (int field = 0; field < FIELDS; ++field)
+		fields[field].store(0);
+}
+
+// Stop monitoring
+stats816::~stats816()
+{
+	stop();
+}
+
+// Open the socket if one is wanted, catch SIGUSR1 and start the monitor. The
+// signal is caught with SA_RESTART so a guest blocked reading its console is
+// not disturbed.
+bool stats816::start()
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (target.compare(0, 5, "unix:") == 0) {
+		sockaddr_un		addr;
+		string			path = target.substr(5);
+
+		if (path.size() >= sizeof(addr.sun_path)) return (false);
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, path.c_str());
+		unlink(path.c_str());
+
+		if ((listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return (false);
+		if ((bind(listener, (sockaddr *) &addr, sizeof(addr)) != 0)
+				|| (listen(listener, 8) != 0)) {
+			close(listener);
+			listener = -1;
+			return (false);
+		}
+		fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+	}
+
+	struct sigaction	action;
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = onSignal;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGUSR1, &action, NULL);
+#else
+	if (target.compare(0, 5, "unix:") == 0) return (false);
+#endif
+
+	running = true;
+	monitor = thread(&stats816::watch, this);
+	return (true);
+}
+
+// Stop the monitor, writing a final snapshot to the file if there is one
+void stats816::stop()
+{
+	if (!running) return;
+
+	running = false;
+	monitor.join();
+
+#if !defined(_WIN32) && !defined(_WIN64)
+	signal(SIGUSR1, SIG_DFL);
+	if (listener >= 0) {
+		close(listener);
+		listener = -1;
+		unlink(target.substr(5).c_str());
+	}
+#endif
+}
+
+//==============================================================================
+// Publishing
+//------------------------------------------------------------------------------
+
+// Write the counters between two increments of the sequence number. A reader
+// that sees an odd number, or a different one afterwards, tries again.
+void stats816::publish()
+{
+	unsigned long	seq = sequence.load(memory_order_relaxed);
+
+	sequence.store(seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	fields[INSTRUCTIONS].store(emu816::getInstructions(), memory_order_relaxed);
+	fields[CYCLES].store(emu816::getCycles(), memory_order_relaxed);
+	fields[MODE_SWITCHES].store(emu816::getModeSwitches(), memory_order_relaxed);
+	fields[INTERRUPTS].store(emu816::getInterrupts(), memory_order_relaxed);
+	fields[PC].store(emu816::getPC(), memory_order_relaxed);
+	fields[FLAGS].store((emu816::isStopped() ? 1 : 0) | (emu816::isWaiting() ? 2 : 0),
+		memory_order_relaxed);
+
+	sequence.store(seq + 2, memory_order_release);
+}
+
+// Copy the counters, retrying if the emulator was part way through publishing
+void stats816::read(Snapshot &snapshot) const
+{
+	unsigned long	before, after, flags;
+
+	do {
+		while ((before = sequence.load(memory_order_acquire)) & 1)
+			this_thread::yield();
+
+		snapshot.instructions = fields[INSTRUCTIONS].load(memory_order_relaxed);
+		snapshot.cycles = fields[CYCLES].load(memory_order_relaxed);
+		snapshot.modeSwitches = fields[MODE_SWITCHES].load(memory_order_relaxed);
+		snapshot.interrupts = fields[INTERRUPTS].load(memory_order_relaxed);
+		snapshot.pc = fields[PC].load(memory_order_relaxed);
+		flags = fields[FLAGS].load(memory_order_relaxed);
+
+		atomic_thread_fence(memory_order_acquire);
+		after = sequence.load(memory_order_relaxed);
+	} while (before != after);
+
+	snapshot.stopped = (flags & 1) != 0;
+	snapshot.waiting = (flags & 2) != 0;
+	snapshot.mhz = 0;
+}
+
+//==============================================================================
+// Monitoring
+//------------------------------------------------------------------------------
+
+// Poll for signals and clients, and take a timed snapshot each interval to
+// work out the recent clock rate.
+void stats816::watch()
+{
+	typedef chrono::steady_clock Clock;
+
+	Snapshot			snapshot;
+	Clock::time_point	last = Clock::now();
+	unsigned long long	lastCycles = 0;
+	double				mhz = 0;
+
+	while (running) {
+		this_thread::sleep_for(chrono::milliseconds(POLL_MS));
+
+		Clock::time_point	now = Clock::now();
+		double				secs = chrono::duration<double>(now - last).count();
+		bool				ending = !running;
+
+		read(snapshot);
+		if ((secs >= interval) || ending) {
+			if (secs > 0)
+				mhz = (snapshot.cycles - lastCycles) / secs / 1000000.0;
+			lastCycles = snapshot.cycles;
+			last = now;
+
+			snapshot.mhz = mhz;
+			if (target.compare(0, 5, "unix:") && (target != "-"))
+				rewrite(format(snapshot));
+		}
+		snapshot.mhz = mhz;
+
+		if (requested) {
+			requested = 0;
+			describe(cerr, snapshot);
+		}
+		if (listener >= 0)
+			serve(format(snapshot));
+	}
+}
+
+// Answer each waiting client with a snapshot and hang up. A client that has
+// already gone simply misses it.
+void stats816::serve(const string &line)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	int		client;
+
+	while ((client = accept(listener, NULL, NULL)) >= 0) {
+		ssize_t	sent = send(client, line.data(), line.size(), MSG_NOSIGNAL);
+
+		(void) sent;
+		close(client);
+	}
+#endif
+}
+
+// Replace the file with the latest snapshot. It is written alongside and then
+// renamed over it so a reader never sees a partial line or a missing file.
+// Only Windows needs the old file removed first, as its rename will not
+// replace one.
+void stats816::rewrite(const string &line)
+{
+	string	temp = target + ".tmp";
+
+	{
+		ofstream	file(temp.c_str());
+
+		if (!file.is_open()) return;
+		file << line;
+	}
+#if defined(_WIN32) || defined(_WIN64)
+	remove(target.c_str());
+#endif
+	rename(temp.c_str(), target.c_str());
+}
+
+// Format a snapshot as a JSON line
+string stats816::format(const Snapshot &snapshot)
+{
+	ostringstream	out;
+
+	out << "{\"instructions\":" << snapshot.instructions
+		<< ",\"cycles\":" << snapshot.cycles
+		<< ",\"mhz\":" << snapshot.mhz
+		<< ",\"modeSwitches\":" << snapshot.modeSwitches
+		<< ",\"interrupts\":" << snapshot.interrupts
+		<< ",\"pc\":" << snapshot.pc
+		<< ",\"state\":\"" << (snapshot.stopped ? "stopped"
+			: snapshot.waiting ? "waiting" : "running") << "\"}" << endl;
+	return (out.str());
+}
+
+// Describe a snapshot for a person
+void stats816::describe(ostream &out, const Snapshot &snapshot)
+{
+	out << "emu816: pc " << toHex(snapshot.pc, 6) << ", "
+		<< snapshot.instructions << " instructions, " << snapshot.cycles
+		<< " cycles, " << snapshot.mhz << " MHz, " << snapshot.modeSwitches
+		<< " mode switches, " << snapshot.interrupts << " interrupts"
+		<< (snapshot.stopped ? ", stopped" : snapshot.waiting ? ", waiting" : "")
+		<< endl;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef STATS816_H
+#define STATS816_H
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "wdc816.h"
+
+// The stats816 class makes the progress of a long running guest visible while
+// it runs. The emulator thread publishes its counters between quanta through a
+// sequence lock, which never blocks it, and a monitor thread takes consistent
+// snapshots to report. A snapshot is written to standard error on SIGUSR1 and
+// can also be rewritten to a file each interval or served as a JSON line to
+// each client connecting to a Unix domain socket.
+
+class stats816 :
+	public wdc816
+{
+public:
+	// A consistent copy of the published counters
+	struct Snapshot {
+		unsigned long	instructions;
+		unsigned long long cycles;
+		unsigned long	modeSwitches;	// Width or mode changing REP/SEP/XCE
+		unsigned long	interrupts;		// Signalled, BRK and COP
+		Addr			pc;
+		bool			stopped;
+		bool			waiting;
+		double			mhz;			// Over the last interval
+	};
+
+	// Report to a file, to a socket given as "unix:path", or with a target of
+	// "-" only on SIGUSR1. Snapshots are taken every interval seconds.
+	stats816(const char *target, double interval);
+	~stats816();
+
+	// Open the target and start the monitor thread
+	bool start();
+
+	// Stop the monitor thread and remove any socket
+	void stop();
+
+	// Copy the attached emulator's counters for the monitor to see
+	void publish();
+
+	// Take a consistent copy of the last published counters
+	void read(Snapshot &snapshot) const;
+
+private:
+	enum { INSTRUCTIONS, CYCLES, MODE_SWITCHES, INTERRUPTS, PC, FLAGS, FIELDS };
+
+	std::atomic<unsigned long>	sequence;		// Odd while being updated
+	std::atomic<unsigned long long> fields[FIELDS];
+
+	std::string			target;
+	double				interval;
+	int					listener;				// Socket or -1
+	std::atomic<bool>	running;
+	std::thread			monitor;
+
+	void watch();
+	void serve(const std::string &line);
+	void rewrite(const std::string &line);
+
+	static std::string format(const Snapshot &snapshot);
+	static void describe(std::ostream &out, const Snapshot &snapshot);
+
+	stats816(const stats816 &);
+	stats816 &operator =(const stats816 &);
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,124 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+#ifdef __linux__
+# include <errno.h>
+# include <time.h>
+#endif
+
+#include "throttle816.h"
+#include "emu816.h"
+
+//==============================================================================
+
+// Never used.
+throttle816::throttle816()
+{ }
+
+// Never used.
+throttle816::~throttle816()
+{ }
+
+//==============================================================================
+
+// Sleep until an absolute point on the steady clock. On Linux this is done with
+// a single absolute clock_nanosleep on the monotonic clock that steady_clock is
+// built on, avoiding the drift of repeated relative sleeps. The sleep is
+// restarted if a signal interrupts it; any other failure falls back on the
+// portable sleep.
+static void sleepUntil(chrono::steady_clock::time_point target)
+{
+#ifdef __linux__
+	chrono::nanoseconds	ns = chrono::duration_cast<chrono::nanoseconds>(
+		target.time_since_epoch());
+	timespec			when;
+
+	when.tv_sec = (time_t)(ns.count() / 1000000000);
+	when.tv_nsec = (long)(ns.count() % 1000000000);
+
+	int					result;
+
+	while ((result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &when, NULL)) == EINTR)
+		continue;
+	if (result != 0)
+		this_thread::sleep_until(target);
+#else
+	this_thread::sleep_until(target);
+#endif
+}
+
+// Run the guest in quanta, keeping the guest clock in step with the host
+void throttle816::run(double hz, unsigned long quantum, Stats &stats)
+{
+	typedef chrono::steady_clock Clock;
+
+	if (quantum == 0)
+		quantum = (unsigned long)(hz / 1000.0) + 1;
+
+	stats.quanta = 0;
+	stats.sleeps = 0;
+	stats.overruns = 0;
+	stats.maxOverrun = 0;
+	stats.meanJitter = 0;
+	stats.maxJitter = 0;
+	stats.drift = 0;
+
+	double			jitter = 0;
+	unsigned long long origin = emu816::getCycles();
+	Clock::time_point start = Clock::now();
+
+	while (!emu816::isStopped() && !emu816::isWaiting()) {
+		emu816::run(quantum);
+		++stats.quanta;
+
+		// Where the host clock should be for the cycles executed so far
+		Clock::time_point target = start + chrono::duration_cast<Clock::duration>(
+			chrono::duration<double>((emu816::getCycles() - origin) / hz));
+		Clock::time_point now = Clock::now();
+
+		if (now < target) {
+			sleepUntil(target);
+
+			double late = chrono::duration<double>(Clock::now() - target).count();
+
+			jitter += late;
+			if (late > stats.maxJitter) stats.maxJitter = late;
+			++stats.sleeps;
+		}
+		else {
+			double late = chrono::duration<double>(now - target).count();
+
+			if (late > stats.maxOverrun) stats.maxOverrun = late;
+			++stats.overruns;
+		}
+	}
+
+	stats.drift = chrono::duration<double>(Clock::now() - start).count()
+		- (emu816::getCycles() - origin) / hz;
+	if (stats.sleeps)
+		stats.meanJitter = jitter / stats.sleeps;
+}
\ No newline at end of file
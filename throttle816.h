@@ -0,0 +1,55 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef THROTTLE816_H
+#define THROTTLE816_H
+
+#include "wdc816.h"
+
+// The throttle816 class runs the emulator on the calling thread at a fixed
+// guest clock rate. Execution proceeds in quanta of cycles and after each one
+// the guest's position is compared with a monotonic host clock, sleeping until
+// the guest time is reached when it is ahead rather than busy-waiting.
+
+class throttle816 :
+	public wdc816
+{
+public:
+	// Timing statistics for a throttled run
+	struct Stats {
+		unsigned long	quanta;			// Quanta executed
+		unsigned long	sleeps;			// Quanta finishing early
+		unsigned long	overruns;		// Quanta finishing late
+		double			maxOverrun;		// Worst lateness in seconds
+		double			meanJitter;		// Average oversleep in seconds
+		double			maxJitter;		// Worst oversleep in seconds
+		double			drift;			// Host minus guest time at the end
+	};
+
+	// Run at hz cycles per second until the guest stops or parks itself. A
+	// quantum of zero selects a millisecond's worth of cycles.
+	static void run(double hz, unsigned long quantum, Stats &stats);
+
+private:
+	throttle816();
+	~throttle816();
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,233 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+#if defined(_WIN32) || defined (_WIN64)
+#include "Windows.h"
+#else
+#include <time.h>
+#endif
+
+#include "timer816.h"
+
+//==============================================================================
+
+// Construct a timer with no samples
+timer816::timer816()
+	: cpuStart(0)
+{ }
+
+// Destroy a timer
+timer816::~timer816()
+{ }
+
+//==============================================================================
+
+// Read the CPU time of the calling thread. Where the host has no per-thread
+// clock the process CPU time is used instead.
+double timer816::threadTime()
+{
+#if defined(_WIN32) || defined (_WIN64)
+	FILETIME	created, exited, kernel, user;
+
+	if (GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) {
+		ULARGE_INTEGER	k, u;
+
+		k.LowPart = kernel.dwLowDateTime;
+		k.HighPart = kernel.dwHighDateTime;
+		u.LowPart = user.dwLowDateTime;
+		u.HighPart = user.dwHighDateTime;
+		return ((k.QuadPart + u.QuadPart) / 10000000.0);
+	}
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+	timespec	now;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0)
+		return (now.tv_sec + now.tv_nsec / 1000000000.0);
+#endif
+	return (clock() / (double) CLOCKS_PER_SEC);
+}
+
+// Note the clocks at the start of a run
+void timer816::start()
+{
+	cpuStart = threadTime();
+	wallStart = chrono::steady_clock::now();
+}
+
+// Add a sample for the run just finished
+void timer816::stop(unsigned long instructions, unsigned long long cycles)
+{
+	chrono::steady_clock::time_point wallEnd = chrono::steady_clock::now();
+	Sample	sample;
+
+	sample.wall = chrono::duration<double>(wallEnd - wallStart).count();
+	sample.cpu = threadTime() - cpuStart;
+	sample.instructions = instructions;
+	sample.cycles = cycles;
+	samples.push_back(sample);
+}
+
+//==============================================================================
+// Reporting
+//------------------------------------------------------------------------------
+
+// The figures derived from a sample
+static double wallOf(const timer816::Sample &sample)
+{
+	return (sample.wall);
+}
+
+static double cpuOf(const timer816::Sample &sample)
+{
+	return (sample.cpu);
+}
+
+static double instructionsOf(const timer816::Sample &sample)
+{
+	return ((double) sample.instructions);
+}
+
+static double cyclesOf(const timer816::Sample &sample)
+{
+	return ((double) sample.cycles);
+}
+
+static double mhzOf(const timer816::Sample &sample)
+{
+	return ((sample.cpu > 0) ? sample.cycles / sample.cpu / 1000000.0 : 0);
+}
+
+static double nsOf(const timer816::Sample &sample)
+{
+	return (sample.instructions ? sample.cpu * 1000000000.0 / sample.instructions : 0);
+}
+
+// The figures in the order they are reported
+static const struct {
+	const char	   *name;
+	const char	   *label;
+	double		  (*figure)(const timer816::Sample &);
+	bool			count;
+} figures[] = {
+	{ "wall",				"Wall time (Secs)",			wallOf,			false },
+	{ "cpu",				"CPU time (Secs)",			cpuOf,			false },
+	{ "instructions",		"Instructions",				instructionsOf,	true },
+	{ "cycles",				"Cycles",					cyclesOf,		true },
+	{ "mhz",				"Emulated MHz",				mhzOf,			false },
+	{ "nsPerInstruction",	"Host ns/instruction",		nsOf,			false }
+};
+
+// Write a figure, showing counts in full rather than in scientific notation
+static void write(ostream &out, double value, bool count)
+{
+	if (count)
+		out << (unsigned long)(value + 0.5);
+	else
+		out << value;
+}
+
+// Find the minimum, median and maximum of one figure
+void timer816::summarise(double (*figure)(const Sample &), double stats[3]) const
+{
+	vector<double>	values;
+
+	for (size_t index = 0; index < samples.size(); ++index)
+		values.push_back(figure(samples[index]));
+	sort(values.begin(), values.end());
+
+	if (values.empty()) {
+		stats[0] = stats[1] = stats[2] = 0;
+		return;
+	}
+
+	size_t	middle = values.size() / 2;
+
+	stats[0] = values.front();
+	stats[1] = (values.size() & 1) ? values[middle]
+		: (values[middle - 1] + values[middle]) / 2;
+	stats[2] = values.back();
+}
+
+// Write a summary for people. A single run is described in a sentence and
+// several as a table of minimum, median and maximum values.
+void timer816::report(ostream &out) const
+{
+	if (samples.size() == 1) {
+		const Sample &sample = samples[0];
+		double	speed = mhzOf(sample) * 1000000.0;
+
+		out << endl << "Executed " << sample.cycles << " cycles, "
+			<< sample.instructions << " instructions in " << sample.wall
+			<< " Secs (" << sample.cpu << " Secs CPU)";
+		out << endl << "Overall CPU Frequency = ";
+		if (speed < 1000.0)
+			out << speed << " Hz";
+		else {
+			if ((speed /= 1000.0) < 1000.0)
+				out << speed << " KHz";
+			else
+				out << (speed /= 1000.0) << " Mhz";
+		}
+		out << ", " << nsOf(sample) << " ns/instruction" << endl;
+		return;
+	}
+
+	out << endl << "Over " << samples.size() << " runs (min / median / max):" << endl;
+	for (size_t index = 0; index < sizeof(figures) / sizeof(figures[0]); ++index) {
+		double	stats[3];
+
+		summarise(figures[index].figure, stats);
+		out << "  " << figures[index].label << ": ";
+		write(out, stats[0], figures[index].count);
+		out << " / ";
+		write(out, stats[1], figures[index].count);
+		out << " / ";
+		write(out, stats[2], figures[index].count);
+		out << endl;
+	}
+}
+
+// Write the summary as a single JSON object
+void timer816::reportJSON(ostream &out) const
+{
+	out << "{\"runs\":" << samples.size();
+	for (size_t index = 0; index < sizeof(figures) / sizeof(figures[0]); ++index) {
+		double	stats[3];
+
+		summarise(figures[index].figure, stats);
+		out << ",\"" << figures[index].name << "\":{\"min\":";
+		write(out, stats[0], figures[index].count);
+		out << ",\"median\":";
+		write(out, stats[1], figures[index].count);
+		out << ",\"max\":";
+		write(out, stats[2], figures[index].count);
+		out << '}';
+	}
+	out << '}' << endl;
+}
\ No newline at end of file
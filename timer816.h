@@ -0,0 +1,79 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef TIMER816_H
+#define TIMER816_H
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "wdc816.h"
+
+// The timer816 class measures runs of the emulator against the host's steady
+// clock and the CPU time consumed by the calling thread. Each run adds a
+// sample and the report gives the minimum, median and maximum of each figure
+// when there are several.
+
+class timer816 :
+	public wdc816
+{
+public:
+	// The measurements of a single run
+	struct Sample {
+		double			wall;			// Elapsed seconds
+		double			cpu;			// Seconds of CPU used by the thread
+		unsigned long	instructions;	// Instructions retired
+		unsigned long long cycles;		// ... and the cycles they took
+	};
+
+	timer816();
+	~timer816();
+
+	// Mark the start of a run
+	void start();
+
+	// Mark the end of a run that executed the given work
+	void stop(unsigned long instructions, unsigned long long cycles);
+
+	// The samples taken so far
+	const std::vector<Sample> &getSamples() const
+	{
+		return (samples);
+	}
+
+	// Write the results as text or as a JSON object
+	void report(std::ostream &out) const;
+	void reportJSON(std::ostream &out) const;
+
+	// The CPU time in seconds used so far by the calling thread
+	static double threadTime();
+
+private:
+	std::chrono::steady_clock::time_point	wallStart;
+	double									cpuStart;
+	std::vector<Sample>						samples;
+
+	// Reduce one figure across all the samples to its minimum, median and
+	// maximum.
+	void summarise(double (*figure)(const Sample &), double stats[3]) const;
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,217 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#include <string.h>
+
+#include "dis816.h"
+#include "trace816.h"
+
+// Identifies a trace file, followed by the size of a record
+static const char magic[4] = { 'T', '8', '1', '6' };
+
+//==============================================================================
+
+// Allocate the ring
+trace816::trace816(size_t capacity)
+	: total(0), streaming(false), drop(false), buffer(0), buffers(0),
+	  head(0), tail(0), closing(false), lost(0), failed(false)
+{
+	size_t	size = 1;
+
+	while (size < capacity) size <<= 1;
+
+	records.resize(size);
+	mask = size - 1;
+	fill = records.data();
+	limit = fill + size;
+}
+
+// Open the trace file and start the writer
+trace816::trace816(const char *filename, bool drop, size_t buffer,
+	unsigned int buffers)
+	: mask(0), total(0), streaming(false), drop(drop), buffer(buffer),
+	  buffers(buffers), head(0), tail(0), closing(false), lost(0),
+	  failed(false)
+{
+	fill = limit = NULL;
+
+	file.open(filename, ios::binary | ios::trunc);
+	if (file.is_open()) {
+		unsigned int	size = sizeof(Record);
+
+		records.resize(buffer * buffers);
+		counts.resize(buffers);
+		fill = records.data();
+		limit = fill + buffer;
+
+		file.write(magic, sizeof(magic));
+		file.write((const char *) &size, sizeof(size));
+		streaming = true;
+		writer = thread([this] { write(); });
+	}
+}
+
+// Finish any stream
+trace816::~trace816()
+{
+	close();
+}
+
+//==============================================================================
+// Streaming
+//------------------------------------------------------------------------------
+
+// Called when the buffer being filled is full. A ring simply wraps around.
+void trace816::advance()
+{
+	if (!streaming) {
+		fill = records.data();
+		return;
+	}
+
+	unsigned long	next = head.load(memory_order_relaxed) + 1;
+
+	if (drop && (next - tail.load(memory_order_acquire) >= buffers)) {
+		// No buffer to move to, so discard this one's contents
+		lost += buffer;
+		fill -= buffer;
+		return;
+	}
+
+	publish(buffer);
+
+	if (next - tail.load(memory_order_acquire) >= buffers) {
+		unique_lock<mutex>	guard(lock);
+
+		space.wait(guard, [&] {
+			return (next - tail.load(memory_order_acquire) < buffers); });
+	}
+
+	fill = &records[(next % buffers) * buffer];
+	limit = fill + buffer;
+}
+
+// Hand the buffer being filled to the writer
+void trace816::publish(size_t count)
+{
+	unsigned long	slot = head.load(memory_order_relaxed);
+
+	counts[slot % buffers] = count;
+	head.store(slot + 1, memory_order_release);
+
+	{ lock_guard<mutex> guard(lock); }
+	ready.notify_one();
+}
+
+// The writer thread's loop
+void trace816::write()
+{
+	for (;;) {
+		unsigned long	slot = tail.load(memory_order_relaxed);
+
+		if (slot == head.load(memory_order_acquire)) {
+			unique_lock<mutex>	guard(lock);
+
+			ready.wait(guard, [&] {
+				return (closing.load() || (slot != head.load(memory_order_acquire))); });
+			if (slot == head.load(memory_order_acquire)) break;
+		}
+
+		const Record   *data = &records[(slot % buffers) * buffer];
+
+		if (!file.write((const char *) data, counts[slot % buffers] * sizeof(Record)))
+			failed = true;
+
+		tail.store(slot + 1, memory_order_release);
+
+		{ lock_guard<mutex> guard(lock); }
+		space.notify_one();
+	}
+}
+
+// Flush the partly filled buffer and wait for the writer to finish
+bool trace816::close()
+{
+	if (!streaming) return (true);
+
+	size_t	count = buffer - (limit - fill);
+
+	if (count > 0) publish(count);
+
+	{
+		lock_guard<mutex>	guard(lock);
+
+		closing = true;
+	}
+	ready.notify_one();
+	writer.join();
+
+	file.close();
+	streaming = false;
+	return (!failed);
+}
+
+//==============================================================================
+// Rendering
+//------------------------------------------------------------------------------
+
+// Render each record held in the order executed
+void trace816::render(ostream &out) const
+{
+	char	line[dis816::LINE_SIZE];
+
+	for (size_t index = 0; index < size(); ++index) {
+		dis816::render((*this)[index], line);
+		out << line << endl;
+	}
+}
+
+// Render the records of a trace file written by this build
+bool trace816::renderFile(const char *filename, ostream &out)
+{
+	ifstream		file(filename, ios::binary);
+	char			header[sizeof(magic)];
+	unsigned int	size;
+	Record			record;
+	char			line[dis816::LINE_SIZE];
+
+	if (!file.read(header, sizeof(header)) || memcmp(header, magic, sizeof(magic)))
+		return (false);
+	if (!file.read((char *) &size, sizeof(size)) || (size != sizeof(Record)))
+		return (false);
+
+	while (file.read((char *) &record, sizeof(record))) {
+		dis816::render(record, line);
+		out << line << '\n';
+	}
+	out.flush();
+	return (true);
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+//==============================================================================
+//                                          .ooooo.     .o      .ooo   
+//                                         d88'   `8. o888    .88'     
+//  .ooooo.  ooo. .oo.  .oo.   oooo  oooo  Y88..  .8'  888   d88'      
+// d88' `88b `888P"Y88bP"Y88b  `888  `888   `88888b.   888  d888P"Ybo. 
+// 888ooo888  888   888   888   888   888  .8'  ``88b  888  Y88[   ]88 
+// 888    .o  888   888   888   888   888  `8.   .88P  888  `Y88   88P 
+// `Y8bod8P' o888o o888o o888o  `V88V"V8P'  `boood8'  o888o  `88bod8'  
+//                                                                    
+// A Portable C++ WDC 65C816 Emulator  
+//------------------------------------------------------------------------------
+// Copyright (C),2016 Andrew John Jacobs
+// All rights reserved.
+//
+// This work is made available under the terms of the Creative Commons
+// Attribution-NonCommercial-ShareAlike 4.0 International license. Open the
+// following URL to see the details.
+//
+// http://creativecommons.org/licenses/by-nc-sa/4.0/
+//------------------------------------------------------------------------------
+
+#ifndef TRACE816_H
+#define TRACE816_H
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "wdc816.h"
+
+// The trace816 class collects raw trace records from an emulator. Each record
+// holds the registers and instruction bytes at the start of an instruction, so
+// capturing one costs a few stores and no formatting. Text is only produced
+// (by dis816) when the records are rendered.
+//
+// A trace either keeps the most recent records in a ring, so that the history
+// of a run is available after it ends, or streams every record to a file. When
+// streaming, records are filled into large buffers that are handed through a
+// single-producer/single-consumer ring to a writer thread, so the emulator
+// never waits on file I/O. If the writer falls behind the emulator either
+// blocks until a buffer is free or discards the buffer and counts the loss.
+
+class trace816 :
+	public wdc816
+{
+public:
+	// The state before an instruction
+	struct Record {
+		unsigned long long cycles;
+		Word			pc;
+		Word			a, x, y, sp, dp;
+		Byte			pbr, dbr;
+		Byte			p;
+		Byte			e;
+		Byte			bytes[4];		// Opcode and operands
+	};
+
+	// Create a ring holding the latest capacity records (rounded up to a
+	// power of two)
+	trace816(size_t capacity);
+
+	// Stream all records to a file through buffers of the given number of
+	// records, dropping rather than blocking when none are free if drop is set
+	trace816(const char *filename, bool drop, size_t buffer = 65536,
+		unsigned int buffers = 8);
+
+	~trace816();
+
+	// The slot for the next record
+	INLINE Record &next()
+	{
+		if (fill == limit) advance();
+		++total;
+		return (*fill++);
+	}
+
+	// The number of records held in the ring
+	INLINE size_t size() const
+	{
+		return ((total < records.size()) ? (size_t) total : records.size());
+	}
+
+	// The number of records captured in total
+	INLINE unsigned long long captured() const
+	{
+		return (total);
+	}
+
+	// The number of records discarded while streaming
+	INLINE unsigned long long dropped() const
+	{
+		return (lost);
+	}
+
+	// Was the stream file opened?
+	INLINE bool isOpen() const
+	{
+		return (streaming);
+	}
+
+	// A record held in the ring, the oldest first
+	INLINE const Record &operator[](size_t index) const
+	{
+		return (records[(size_t)(total - size() + index) & mask]);
+	}
+
+	// Render the records held in the ring as text, one line each
+	void render(std::ostream &out) const;
+
+	// Write out the remaining records and stop the writer thread
+	bool close();
+
+	// Render a trace file as text
+	static bool renderFile(const char *filename, std::ostream &out);
+
+private:
+	std::vector<Record>	records;
+	size_t				mask;			// Ring index mask
+	unsigned long long	total;
+	Record			   *fill;			// Next free slot
+	Record			   *limit;			// End of the buffer being filled
+
+	bool				streaming;
+	bool				drop;
+	size_t				buffer;			// Records per buffer
+	unsigned int		buffers;
+	std::vector<size_t>	counts;			// Records in each full buffer
+	std::atomic<unsigned long> head;	// Buffers handed to the writer
+	std::atomic<unsigned long> tail;	// Buffers written
+	std::atomic<bool>	closing;
+	unsigned long long	lost;
+	bool				failed;
+
+	std::ofstream		file;
+	std::thread			writer;
+	std::mutex			lock;			// Used only to sleep and wake
+	std::condition_variable	ready;		// Signalled when a buffer is handed over
+	std::condition_variable	space;		// Signalled when a buffer is written
+
+	void advance();
+	void publish(size_t count);
+	void write();
+};
+#endif
\ No newline at end of file
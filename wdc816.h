@@ -24,8 +24,10 @@
 
 #ifdef CHIPKIT
 # define INLINE inline
+# define THREAD_LOCAL
 #else
 # define INLINE inline
+# define THREAD_LOCAL thread_local
 #endif
 
 // The wdc816 class defines common types for 8-, 16- and 24-bit data values and